@@ -0,0 +1,132 @@
+// Builds the calctree AST for long expressions the old way (tree surgery
+// under the root per operator) and bottom-up on compact_tree.
+//
+//   ./bench-calctree-build [terms] [rounds]
+//
+// Both builders get the same postfix step sequence, the order in which
+// Marpa's valuator hands out token and rule steps. "left" is the parse of
+// 1+2+3+... as a left-deep tree, "balanced" splits every range in half.
+// The surgery copies the moved subtree (append_child of an iterator), so
+// it is quadratic on left-deep input; keep terms modest.
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../tree.hh"
+#include "../tree_pool.hh"
+#include "../compact_tree.hh"
+
+const int T_VAL = 1;
+const int T_OP  = 2;
+const int T_TOP = 3;
+
+struct node {
+    int type;
+    int val;
+};
+
+struct step {
+    int type;   // T_VAL or T_OP
+    int val;
+};
+
+void make_left(std::vector<step>& steps, int terms) {
+    steps.push_back(step{ T_VAL, 1 });
+    for (int i = 1; i < terms; ++i) {
+        steps.push_back(step{ T_VAL, i + 1 });
+        steps.push_back(step{ T_OP, 1 + i % 3 });
+    }
+}
+
+void make_balanced(std::vector<step>& steps, int lo, int hi) {
+    if (hi - lo == 1) {
+        steps.push_back(step{ T_VAL, lo + 1 });
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    make_balanced(steps, lo, mid);
+    make_balanced(steps, mid, hi);
+    steps.push_back(step{ T_OP, 1 + lo % 3 });
+}
+
+// Order dependent hash of the pre-order walk.
+template <class Tree>
+unsigned long checksum(const Tree& t) {
+    unsigned long h = 0;
+    for (auto it = t.begin(); it != t.end(); ++it) {
+        h = h * 31 + it->type * 7 + it->val;
+    }
+    return h;
+}
+
+typedef std::chrono::steady_clock clock_type;
+
+template <class F>
+void run(const char* name, const std::vector<step>& steps, int rounds, F build) {
+    unsigned long sum = 0;
+    auto start = clock_type::now();
+    for (int i = 0; i < rounds; ++i) {
+        sum += build(steps);
+    }
+    double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    std::cout << "  " << std::setw(12) << std::left << name << std::right << std::fixed << std::setprecision(4)
+              << secs / rounds << "s per tree  " << std::setprecision(1)
+              << steps.size() * double(rounds) / secs / 1e6 << " Msteps/s  checksum " << sum << "\n";
+}
+
+// What the calctree actions used to do: every value is a child of the
+// root, an operator moves the last two children under a new node.
+unsigned long build_surgery(const std::vector<step>& steps) {
+    typedef tree<node, tree_pool_allocator<tree_node_<node> > > node_tree;
+    node_tree t{ node{ T_TOP, 0 } };
+    for (const step& s : steps) {
+        if (s.type == T_VAL) {
+            t.append_child(t.begin(), node{ T_VAL, s.val });
+            continue;
+        }
+        auto it = t.insert_after(t.begin(), node{ T_OP, s.val });
+        auto sf = t.end(t.begin());
+        auto sl = sf;
+        sf--; sf--;
+        t.reparent(it, sf, sl);
+        t.append_child(t.begin(), it);
+        t.erase(it);
+    }
+    return checksum(t);
+}
+
+unsigned long build_stack(const std::vector<step>& steps) {
+    typedef compact_tree<node> node_tree;
+    node_tree t;
+    std::vector<node_tree::index_type> stack;
+    for (const step& s : steps) {
+        if (s.type == T_VAL) {
+            stack.push_back(t.add(node{ T_VAL, s.val }));
+            continue;
+        }
+        node_tree::index_type right = stack.back(); stack.pop_back();
+        node_tree::index_type left  = stack.back(); stack.pop_back();
+        stack.push_back(t.add(node{ T_OP, s.val }, left, right));
+    }
+    t.set_root(t.add(node{ T_TOP, 0 }, stack[0]));
+    return checksum(t);
+}
+
+int main(int argc, char** argv) {
+    int terms  = argc > 1 ? atoi(argv[1]) : 5000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 3;
+
+    std::vector<step> left, balanced;
+    make_left(left, terms);
+    make_balanced(balanced, 0, terms);
+
+    std::cout << terms << " terms, left-deep\n";
+    run("surgery", left, rounds, build_surgery);
+    run("stack", left, rounds, build_stack);
+
+    std::cout << terms << " terms, balanced\n";
+    run("surgery", balanced, rounds, build_surgery);
+    run("stack", balanced, rounds, build_stack);
+}
@@ -0,0 +1,83 @@
+// Ingesting a large comma-separated list of numbers: the scanner one token
+// at a time with push_back into a vector, as comma used to, against
+// read_number_column(). The recognizer is replaced by a token counter, so
+// this measures lexing and storing only.
+//
+//   ./bench-comma-ingest [megabytes]
+//
+// The input is generated in memory, numbers of 1 to 10 digits, so the
+// default of 1024 MB holds about 180 million numbers.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../lexer.h"
+#include "../number_column.h"
+
+enum { S_NUMBER = 1, S_COMMA = 2 };
+
+typedef std::chrono::steady_clock clock_type;
+
+void report(const char* name, double secs, size_t bytes, size_t numbers, size_t tokens) {
+    std::cout << std::setw(22) << std::left << name << std::right << std::fixed << std::setprecision(3)
+              << secs << "s  " << std::setw(7) << std::setprecision(0) << bytes / secs / 1e6 << " MB/s  "
+              << std::setw(6) << std::setprecision(1) << numbers / secs / 1e6 << " Mnumbers/s  "
+              << tokens << " tokens\n";
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? atol(argv[1]) : 1024;
+    size_t size = megabytes << 20;
+
+    std::string input;
+    input.reserve(size + 16);
+    std::vector<int> expect;
+    srand(1);
+    while (input.size() < size) {
+        if (!expect.empty()) input += ',';
+        int digits = 1 + rand() % 10;
+        long long n = rand() % 10;
+        for (int i = 1; i < digits; ++i) n = n * 10 + rand() % 10;
+        if (n > INT_MAX) n %= INT_MAX;
+        expect.push_back(int(n));
+        input += std::to_string(n);
+    }
+    input += '\n';
+    const char* first = input.data();
+    const char* last  = first + input.size();
+
+    lexer_table<> lex;
+    lex.add_literal(",", S_COMMA, 0);
+    lex.number(S_NUMBER);
+
+    std::cout << input.size() / 1e6 << " MB, " << expect.size() << " numbers\n";
+
+    {
+        auto start = clock_type::now();
+        std::vector<int> numbers;
+        scanner<lexer_table<>> s(lex, first, last);
+        lexeme token;
+        size_t tokens = 0;
+        while (s.next(token) == LEX_TOKEN) {
+            ++tokens;
+            if (token.symbol == S_NUMBER) numbers.push_back(number_value(token.value));
+        }
+        double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+        report("scanner + push_back", secs, input.size(), numbers.size(), tokens);
+        if (numbers != expect) std::cout << "  MISMATCH\n";
+    }
+
+    {
+        auto start = clock_type::now();
+        std::vector<int> numbers;
+        lexeme token;
+        size_t tokens = 0;
+        auto read = [&](const lexeme&) { ++tokens; return true; };
+        lexer_status status = read_number_column(lex, ',', first, last, numbers, read, token);
+        double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+        report("read_number_column", secs, input.size(), numbers.size(), tokens);
+        if (status != LEX_END || numbers != expect || tokens != 2 * expect.size() - 1) std::cout << "  MISMATCH\n";
+    }
+}
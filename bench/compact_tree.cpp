@@ -0,0 +1,114 @@
+// Memory use and traversal speed of tree.hh against compact_tree.hh.
+//
+//   ./bench-compact-tree [nodes] [passes]
+//
+// Both trees get the same shape: every node is appended under a random
+// earlier node. The pre-order and leaf passes sum the node values.
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../tree.hh"
+#include "../compact_tree.hh"
+
+struct node {
+    int type;
+    int val;
+};
+
+typedef std::chrono::steady_clock clock_type;
+
+double since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+template <class Tree>
+long pre_order_sum(const Tree& t, int passes) {
+    long sum = 0;
+    for (int p = 0; p < passes; ++p) {
+        for (auto it = t.begin(); it != t.end(); ++it) {
+            sum += it->val;
+        }
+    }
+    return sum;
+}
+
+template <class Tree>
+long leaf_sum(const Tree& t, int passes) {
+    long sum = 0;
+    for (int p = 0; p < passes; ++p) {
+        for (auto it = t.begin_leaf(); it != t.end_leaf(); ++it) {
+            sum += it->val;
+        }
+    }
+    return sum;
+}
+
+template <class Tree>
+void report(const char* name, const Tree& t, double build, size_t bytes, int nodes, int passes) {
+    auto start = clock_type::now();
+    long pre = pre_order_sum(t, passes);
+    double pre_secs = since(start);
+
+    start = clock_type::now();
+    long leaf = leaf_sum(t, passes);
+    double leaf_secs = since(start);
+
+    std::cout << std::setw(22) << std::left << name << std::right << std::fixed << std::setprecision(3)
+              << "  build " << build << "s  pre-order " << pre_secs << "s  leaves " << leaf_secs
+              << "s  " << std::setprecision(1) << double(bytes) / nodes << " bytes/node"
+              << "  checksum " << pre << "/" << leaf << "\n";
+}
+
+void run_tree(const std::vector<int>& parents, int passes) {
+    typedef tree<node> tree_type;
+    int nodes = parents.size();
+
+    auto start = clock_type::now();
+    tree_type t;
+    std::vector<tree_type::iterator> its;
+    its.reserve(nodes);
+    its.push_back(t.set_head(node{ 0, 0 }));
+    for (int i = 1; i < nodes; ++i) {
+        its.push_back(t.append_child(its[parents[i]], node{ 1, i }));
+    }
+    double build = since(start);
+
+    report("tree.hh", t, build, sizeof(tree_node_<node>) * nodes, nodes, passes);
+}
+
+void run_compact(const std::vector<int>& parents, int passes, bool linear) {
+    typedef compact_tree<node> tree_type;
+    int nodes = parents.size();
+
+    auto start = clock_type::now();
+    tree_type t;
+    t.reserve(nodes);
+    t.set_head(node{ 0, 0 });
+    for (int i = 1; i < nodes; ++i) {
+        t.append_child(tree_type::iterator(&t, parents[i]), node{ 1, i });
+    }
+    if (linear) {
+        t.linearize();
+    }
+    double build = since(start);
+
+    size_t bytes = (sizeof(node) + 4 * sizeof(tree_type::index_type)) * nodes;
+    report(linear ? "compact_tree, linear" : "compact_tree", t, build, bytes, nodes, passes);
+}
+
+int main(int argc, char** argv) {
+    int nodes  = argc > 1 ? atoi(argv[1]) : 1000000;
+    int passes = argc > 2 ? atoi(argv[2]) : 10;
+
+    srand(1);
+    std::vector<int> parents(nodes, 0);
+    for (int i = 1; i < nodes; ++i) {
+        parents[i] = rand() % i;
+    }
+
+    run_tree(parents, passes);
+    run_compact(parents, passes, false);
+    run_compact(parents, passes, true);
+}
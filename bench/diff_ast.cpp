@@ -0,0 +1,205 @@
+// Compares the shared_ptr/virtual expression tree diff.txt used to build
+// with the arena in diff_ast.h.
+//
+//   ./bench-diff-ast [terms]
+//
+// Both builders get the same postfix step sequence, the order in which
+// Marpa's valuator hands out token and rule steps.
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "../symbol_table.h"
+#include "../diff_ast.h"
+
+namespace old {
+
+class node {
+    public:
+        virtual ~node() {}
+        virtual void show(std::ostream& out) = 0;
+};
+
+class id : public node {
+    public:
+        virtual void show(std::ostream& out) { out << "x"; }
+};
+
+class op : public node {
+    public:
+        op(std::shared_ptr<node> left, std::shared_ptr<node> right) : left(left), right(right) {}
+        virtual void show(std::ostream& out) {
+            out << "(";
+            left->show(out);
+            out << " " << oper() << " ";
+            right->show(out);
+            out << ")";
+        }
+        virtual std::string oper() const = 0;
+    private:
+        std::shared_ptr<node> left;
+        std::shared_ptr<node> right;
+};
+
+class op_add : public op {
+    public:
+        op_add(std::shared_ptr<node> left, std::shared_ptr<node> right) : op(left, right) {}
+        virtual std::string oper() const { return "+"; }
+};
+
+class op_mul : public op {
+    public:
+        op_mul(std::shared_ptr<node> left, std::shared_ptr<node> right) : op(left, right) {}
+        virtual std::string oper() const { return "*"; }
+};
+
+class number : public node {
+    public:
+        number(int n) : n(n) {}
+        virtual void show(std::ostream& out) { out << n; }
+    private:
+        int n;
+};
+
+}
+
+class null_buffer : public std::streambuf {
+    public:
+        null_buffer() : count(0) {}
+        long count;
+    protected:
+        virtual int_type overflow(int_type c) { ++count; return c; }
+        virtual std::streamsize xsputn(const char*, std::streamsize n) { count += n; return n; }
+};
+
+enum { STEP_NUMBER, STEP_X, STEP_ADD, STEP_MUL };
+
+struct step {
+    int type;
+    int value;
+};
+
+void make_steps(std::vector<step>& steps, int lo, int hi) {
+    if (hi - lo == 1) {
+        if (lo % 3 == 2) steps.push_back(step{ STEP_X, 0 });
+        else             steps.push_back(step{ STEP_NUMBER, rand() % 1000 });
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    make_steps(steps, lo, mid);
+    make_steps(steps, mid, hi);
+    steps.push_back(step{ rand() % 2 ? STEP_ADD : STEP_MUL, 0 });
+}
+
+typedef std::chrono::steady_clock clock_type;
+
+double since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+void report(const char* name, double lex, double build, double show, double free, long bytes) {
+    std::cout << std::setw(12) << std::left << name << std::right << std::fixed << std::setprecision(4)
+              << "  lex " << lex << "s  build " << build << "s  show " << show
+              << "s  free " << free << "s  output " << bytes << " bytes\n";
+}
+
+void run_old(const std::vector<step>& steps) {
+    typedef std::shared_ptr<old::node> ptr;
+
+    auto start = clock_type::now();
+    indexed_table<ptr> nodes;
+    std::vector<int> token_values;
+    for (const step& s : steps) {
+        if (s.type == STEP_NUMBER) {
+            token_values.push_back(nodes.add(std::make_shared<old::number>(s.value)));
+        }
+    }
+    double lex = since(start);
+
+    start = clock_type::now();
+    std::vector<ptr> stack;
+    size_t next_number = 0;
+    for (const step& s : steps) {
+        switch (s.type) {
+            case STEP_NUMBER: stack.push_back(nodes[token_values[next_number++]]); break;
+            case STEP_X:      stack.push_back(std::make_shared<old::id>()); break;
+            default: {
+                ptr right = stack.back(); stack.pop_back();
+                ptr left  = stack.back(); stack.pop_back();
+                if (s.type == STEP_ADD) stack.push_back(std::make_shared<old::op_add>(left, right));
+                else                    stack.push_back(std::make_shared<old::op_mul>(left, right));
+            }
+        }
+    }
+    double build = since(start);
+
+    start = clock_type::now();
+    null_buffer buf;
+    std::ostream out(&buf);
+    stack[0]->show(out);
+    double show = since(start);
+
+    start = clock_type::now();
+    stack.clear();
+    nodes.clear();
+    double free = since(start);
+
+    report("shared_ptr", lex, build, show, free, buf.count);
+}
+
+void run_arena(const std::vector<step>& steps) {
+    expr_arena ast;
+
+    auto start = clock_type::now();
+    std::vector<int> token_values;
+    for (const step& s : steps) {
+        if (s.type == STEP_NUMBER) {
+            token_values.push_back(ast.number(s.value));
+        }
+    }
+    double lex = since(start);
+
+    start = clock_type::now();
+    std::vector<expr_arena::index> stack;
+    size_t next_number = 0;
+    for (const step& s : steps) {
+        switch (s.type) {
+            case STEP_NUMBER: stack.push_back(token_values[next_number++]); break;
+            case STEP_X:      stack.push_back(ast.x()); break;
+            default: {
+                expr_arena::index right = stack.back(); stack.pop_back();
+                expr_arena::index left  = stack.back(); stack.pop_back();
+                stack.push_back(ast.op(s.type == STEP_ADD ? EXPR_ADD : EXPR_MUL, left, right));
+            }
+        }
+    }
+    double build = since(start);
+
+    start = clock_type::now();
+    null_buffer buf;
+    std::ostream out(&buf);
+    ast.show(stack[0], out);
+    double show = since(start);
+
+    start = clock_type::now();
+    ast.clear();
+    double free = since(start);
+
+    report("arena", lex, build, show, free, buf.count);
+}
+
+int main(int argc, char** argv) {
+    int terms = argc > 1 ? atoi(argv[1]) : 100000;
+
+    srand(1);
+    std::vector<step> steps;
+    make_steps(steps, 0, terms);
+
+    std::cout << terms << " terms, " << steps.size() << " steps\n";
+    run_old(steps);
+    run_arena(steps);
+}
@@ -0,0 +1,101 @@
+// Evaluating one diff expression over an array of x: a recursive walk of
+// the AST per element against the block programs of diff_eval.h.
+//
+//   ./bench-diff-eval [points] [depth]
+//
+// The expression is a random balanced tree over x, small numbers,
+// + - * / and x^n, the same for every run.
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "../diff_eval.h"
+
+template <class T>
+T walk(const expr_arena& ast, expr_arena::index i, T x) {
+    const expr_node& n = ast[i];
+    switch (n.kind) {
+        case EXPR_X:      return x;
+        case EXPR_NUMBER: return T(n.value);
+        case EXPR_ADD:    return walk(ast, n.left, x) + walk(ast, n.right, x);
+        case EXPR_SUB:    return walk(ast, n.left, x) - walk(ast, n.right, x);
+        case EXPR_MUL:    return walk(ast, n.left, x) * walk(ast, n.right, x);
+        case EXPR_DIV:    return walk(ast, n.left, x) / walk(ast, n.right, x);
+        case EXPR_POWER: {
+            T r = 1, b = walk(ast, n.left, x);
+            for (int k = 0; k < ast[n.right].value; ++k) r *= b;
+            return r;
+        }
+    }
+    return 0;
+}
+
+expr_arena::index make_expr(expr_arena& ast, int depth) {
+    if (depth == 0) {
+        switch (rand() % 3) {
+            case 0:  return ast.x();
+            case 1:  return ast.number(1 + rand() % 9);
+            default: return ast.op(EXPR_POWER, ast.x(), ast.number(2 + rand() % 3));
+        }
+    }
+    static const expr_kind ops[] = { EXPR_ADD, EXPR_SUB, EXPR_MUL, EXPR_ADD, EXPR_DIV };
+    expr_arena::index left  = make_expr(ast, depth - 1);
+    expr_arena::index right = make_expr(ast, depth - 1);
+    return ast.op(ops[rand() % 5], left, right);
+}
+
+typedef std::chrono::steady_clock clock_type;
+
+template <class T, class F>
+void run(const char* name, const std::vector<T>& xs, std::vector<T>& ys, const std::vector<double>& expect, F f) {
+    auto start = clock_type::now();
+    f(xs.data(), ys.data(), xs.size());
+    double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    double max_err = 0;
+    for (size_t i = 0; i < xs.size(); ++i) {
+        double e = std::fabs(ys[i] - expect[i]) / std::max(1.0, std::fabs(expect[i]));
+        if (e > max_err) max_err = e;
+    }
+    std::cout << std::setw(22) << std::left << name << std::right << std::fixed << std::setprecision(4)
+              << secs << "s  " << std::setw(8) << std::setprecision(1) << xs.size() / secs / 1e6
+              << " Mevals/s  max rel. error " << std::scientific << std::setprecision(1) << max_err << "\n";
+}
+
+int main(int argc, char** argv) {
+    size_t points = argc > 1 ? atol(argv[1]) : 4000000;
+    int    depth  = argc > 2 ? atoi(argv[2]) : 5;
+
+    srand(1);
+    expr_arena ast;
+    expr_arena::index root = make_expr(ast, depth);
+    expr_program program(ast, root);
+
+    std::cout << ast.size() - 1 << " nodes, " << program.size() << " instructions, "
+              << program.registers() << " registers, avx2 " << (expr_program::has_avx2() ? "yes" : "no") << "\n";
+
+    std::vector<double> xd(points), yd(points), expect(points);
+    std::vector<float>  xf(points), yf(points);
+    for (size_t i = 0; i < points; ++i) {
+        xd[i] = 0.5 + 2.0 * i / points;
+        xf[i] = float(xd[i]);
+    }
+
+    auto start = clock_type::now();
+    for (size_t i = 0; i < points; ++i) expect[i] = walk(ast, root, xd[i]);
+    double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+    std::cout << std::setw(22) << std::left << "walk, double" << std::right << std::fixed << std::setprecision(4)
+              << secs << "s  " << std::setw(8) << std::setprecision(1) << points / secs / 1e6 << " Mevals/s\n";
+
+    run("walk, float", xf, yf, expect, [&](const float* x, float* y, size_t n) {
+        for (size_t i = 0; i < n; ++i) y[i] = walk(ast, root, x[i]);
+    });
+    run("program, double", xd, yd, expect, [&](const double* x, double* y, size_t n) { program.eval_scalar(x, y, n); });
+    run("program, float", xf, yf, expect, [&](const float* x, float* y, size_t n) { program.eval_scalar(x, y, n); });
+    if (expr_program::has_avx2()) {
+        run("program avx2, double", xd, yd, expect, [&](const double* x, double* y, size_t n) { program.eval(x, y, n); });
+        run("program avx2, float", xf, yf, expect, [&](const float* x, float* y, size_t n) { program.eval(x, y, n); });
+    }
+}
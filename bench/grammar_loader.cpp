@@ -0,0 +1,84 @@
+// How long grammar_loader takes to turn the rules DSL into a precomputed
+// grammar, against the generate and compile cycle it replaces.
+//
+//   ./bench-grammar-loader [file] [expression]
+//
+// Without a file the grammar is calc.txt's, with named actions. The
+// loaded grammar then parses and evaluates the expression, 2+3*4-5 by
+// default, with lexer.h as the generated calc does.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "../grammar_loader.h"
+#include "../read_file.h"
+#include "../lexer.h"
+
+const char* calc_rules =
+    "expr   ::= term\n"
+    "term   ::= term add term          {{ add }}\n"
+    "term   ::= term sub term          {{ sub }}\n"
+    "term   ::= factor\n"
+    "factor ::= factor mul factor      {{ mul }}\n"
+    "factor ::= number                 {{ num }}\n"
+    "add ~ \"+\"\n"
+    "sub ~ \"-\"\n"
+    "mul ~ \"*\"\n"
+    "%left add sub\n"
+    "%left mul\n"
+    "%unvalued add sub mul\n";
+
+int main(int argc, char** argv) {
+    std::string text = argc > 1 ? read_file(argv[1]) : std::string(calc_rules);
+    std::string input = argc > 2 ? argv[2] : "2+3*4-5";
+
+    grammar_loader loader;
+    loader.bind("add", [](const int* a, const int*) { return a[0] + a[2]; });
+    loader.bind("sub", [](const int* a, const int*) { return a[0] - a[2]; });
+    loader.bind("mul", [](const int* a, const int*) { return a[0] * a[2]; });
+    loader.bind("num", [](const int* a, const int*) { return number_value(a[0]); });
+
+    const int rounds = 100;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        if (!loader.load(text, error)) {
+            std::cout << (argc > 1 ? argv[1] : "calc") << ":" << error << "\n";
+            return 1;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << loader.symbol_count() << " symbols, load " << std::fixed << std::setprecision(3)
+              << secs * 1e3 / rounds << " ms\n";
+
+    lexer_table<> lex;
+    loader.create_lexer(lex);
+    if (loader.symbol("number") >= 0) {
+        lex.number(loader.symbol("number"));
+    }
+
+    marpa::recognizer r(loader.grammar());
+    scanner<lexer_table<>> s(lex, input.data(), input.data() + input.size());
+    lexeme token;
+    lexer_status status = read_tokens(r, s, token);
+    if (status != LEX_END) {
+        std::cout << lexer_status_name(status) << " at offset " << token.offset << "\n";
+        return 1;
+    }
+
+    marpa::bocage b{r, r.latest_earley_set()};
+    if (loader.grammar().error() != MARPA_ERR_NONE) {
+        std::cout << "no parse\n";
+        return 1;
+    }
+    marpa::order o{b};
+    marpa::tree t{o};
+    std::vector<int> stack;
+    while (t.next() >= 0) {
+        marpa::value v{t};
+        loader.set_valued(v);
+        std::cout << input << " = " << loader.evaluate(v, stack) << "\n";
+    }
+    return 0;
+}
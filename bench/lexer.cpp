@@ -0,0 +1,159 @@
+// Compares lexer.h against the tokenizer loops of the generated mains.
+//
+//   ./bench-lexer [megabytes]
+//
+// Input is a calc style expression; every loop sums symbol * value and
+// counts tokens, and the run fails unless all loops agree.
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include "../util.h"
+#include "../lexer.h"
+
+using std::make_pair;
+
+enum { S_NUMBER = 1, S_ADD, S_SUB, S_MUL };
+
+struct counter {
+    long tokens;
+    long sum;
+
+    counter() : tokens(0), sum(0) {}
+
+    int read(int symbol, int value, int) {
+        ++tokens;
+        sum += symbol * value;
+        return 0;
+    }
+
+    // read_tokens() reads this way, with lexer.h's number values
+    int alternative(int symbol, int value, int length) {
+        return read(symbol, symbol == S_NUMBER ? number_value(value) : value, length);
+    }
+    int earleme_complete() { return 0; }
+};
+
+std::string make_input(size_t size) {
+    const char* ops[] = { " + ", " - ", " * " };
+    std::string input;
+    input.reserve(size + 32);
+    srand(1);
+    while (input.size() < size) {
+        input += std::to_string(rand() % 100000);
+        input += ops[rand() % 3];
+    }
+    input += "1";
+    return input;
+}
+
+// calc.txt / calctree.txt / diff.txt
+void if_chain(counter& r, std::string& input) {
+    auto it = input.begin();
+    while (it != input.end()) {
+        if (isspace(*it)) {
+            it++;
+        }
+        else if (isdigit(*it)) {
+            auto n = parse_digit(it, input.end(), 10, '0');
+            r.read(S_NUMBER, n.second, 1);
+            it = n.first;
+        }
+        else if (*it == '+') {
+            r.read(S_ADD, 1, 1);
+            it++;
+        }
+        else if (*it == '-') {
+            r.read(S_SUB, 1, 1);
+            it++;
+        }
+        else if (*it == '*') {
+            r.read(S_MUL, 1, 1);
+            it++;
+        }
+    }
+}
+
+// comma.txt / literal.txt / balanced.txt
+void tuple_list(counter& r, std::string& input) {
+    std::vector<std::tuple<std::string, int, int>> tokens{
+        std::make_tuple("+", S_ADD, 1),
+        std::make_tuple("-", S_SUB, 1),
+        std::make_tuple("*", S_MUL, 1),
+    };
+
+    auto it = input.begin();
+    while (it != input.end()) {
+        if (isspace(*it)) {
+            it++;
+        }
+        else if (isdigit(*it)) {
+            auto n = parse_digit(it, input.end(), 10, '0');
+            r.read(S_NUMBER, n.second, 1);
+            it = n.first;
+        }
+        else {
+            for (auto t : tokens) {
+                auto new_it = match(it, input.end(), std::get<0>(t).begin(), std::get<0>(t).end());
+                if (new_it != it) {
+                    r.read(std::get<1>(t), std::get<2>(t), 1);
+                    it = new_it;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void table_driven(counter& r, std::string& input) {
+    lexer_table<> lex;
+    lex.add_literal("+", S_ADD, 1);
+    lex.add_literal("-", S_SUB, 1);
+    lex.add_literal("*", S_MUL, 1);
+    lex.number(S_NUMBER);
+
+    scanner<lexer_table<>> s(lex, input.data(), input.data() + input.size());
+    lexeme token;
+    lexer_status status = read_tokens(r, s, token);
+    if (status != LEX_END) {
+        std::cout << "lexer.h: " << lexer_status_name(status) << " at offset " << token.offset << "\n";
+    }
+}
+
+template <class F>
+counter run(const char* name, F f, std::string& input) {
+    counter r;
+    auto start = std::chrono::steady_clock::now();
+    f(r, input);
+    auto end   = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(end - start).count();
+    std::cout << std::setw(14) << std::left << name
+              << std::setw(10) << std::right << r.tokens << " tokens  "
+              << std::setw(8) << (input.size() / secs / 1e6) << " MB/s  "
+              << "sum " << r.sum << "\n";
+    return r;
+}
+
+int main(int argc, char** argv) {
+    size_t mb = argc > 1 ? atoi(argv[1]) : 16;
+    std::string input = make_input(mb * 1024 * 1024);
+
+    counter runs[] = {
+        run("if-chain",     if_chain,     input),
+        run("tuple-list",   tuple_list,   input),
+        run("lexer.h",      table_driven, input),
+    };
+    for (const counter& c : runs) {
+        if (c.tokens != runs[0].tokens || c.sum != runs[0].sum) {
+            std::cout << "MISMATCH: the loops read different tokens\n";
+            return 1;
+        }
+    }
+    return 0;
+}
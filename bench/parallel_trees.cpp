@@ -0,0 +1,121 @@
+// Evaluation of every parse tree of an ambiguous expression, one tree
+// after another with marpa::value, against parallel_trees() on 1, 2, 4, ...
+// threads up to the number of cores.
+//
+//   ./bench-parallel-trees [operators] [work]
+//
+// The grammar is E ::= E op E | number, so n operators give Catalan(n)
+// trees. Every rule step does `work` rounds of arithmetic, standing in
+// for expensive semantics. All runs must compute the same values, in the
+// same order.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <stdint.h>
+#include "../marpa-cpp/marpa.hpp"
+#include "../parallel_eval.h"
+
+using namespace marpa;
+
+grammar::symbol_id expr, op, number;
+grammar::rule_id   op_rule_id;
+int                work;
+
+void build(grammar& g) {
+    expr = g.new_symbol();  op = g.new_symbol();  number = g.new_symbol();
+    op_rule_id = g.add_rule(expr, { expr, op, expr });
+    g.add_rule(expr, { number });
+    g.start_symbol(expr);
+}
+
+void set_valued(value& v) {
+    v.symbol_is_valued(expr, 1);
+    v.symbol_is_valued(number, 1);
+    v.symbol_is_valued(op, 0);
+}
+
+// v is a marpa::value or a value_tape::cursor
+template <class V>
+int evaluate(V& v, std::vector<uint32_t>& stack) {
+    for (;;) {
+        value::step_type type = v.step();
+        if (type == MARPA_STEP_INACTIVE) break;
+        if (size_t(v.result()) + 3 >= stack.size()) stack.resize(2 * stack.size() + 16);
+        if (type == MARPA_STEP_TOKEN) {
+            stack[v.result()] = v.token_value();
+        }
+        else if (type == MARPA_STEP_RULE) {
+            int a = v.arg_0();
+            if (v.rule() != op_rule_id) continue;
+            uint32_t h = stack[a] * 31 + stack[a + 2];
+            for (int i = 0; i < work; ++i) h = h * 1103515245 + 12345;
+            stack[v.result()] = h;
+        }
+    }
+    return int(stack[0] & 0x7fffffff);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 10;
+    work  = argc > 2 ? atoi(argv[2]) : 2000;
+
+    grammar g;
+    build(g);
+    if (g.precompute() < 0) {
+        std::cout << "precompute failed, error " << g.error() << "\n";
+        return 1;
+    }
+
+    recognizer r(g);
+    for (int i = 0; i <= n; ++i) {
+        if (r.alternative(number, 1 + i % 9, 1) != MARPA_ERR_NONE || r.earleme_complete() < 0
+                || (i < n && (r.alternative(op, 1, 1) != MARPA_ERR_NONE || r.earleme_complete() < 0))) {
+            std::cout << "input rejected\n";
+            return 1;
+        }
+    }
+    bocage b{r, r.latest_earley_set()};
+
+    std::vector<int> expected;
+    {
+        auto start = std::chrono::steady_clock::now();
+        order o{b};
+        tree t{o};
+        std::vector<uint32_t> stack(16);
+        while (t.next() >= 0) {
+            value v{t};
+            set_valued(v);
+            expected.push_back(evaluate(v, stack));
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << n << " operators, " << expected.size() << " trees, work " << work << "\n"
+                  << std::setw(14) << std::left << "value" << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(9) << secs * 1e3 << " ms\n";
+    }
+
+    int cores = std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= std::max(cores, 1); threads *= 2) {
+        std::vector<std::vector<uint32_t>> stacks(threads, std::vector<uint32_t>(16));
+        std::vector<int> results;
+
+        auto start = std::chrono::steady_clock::now();
+        order o{b};
+        parallel_trees(o, threads, set_valued, [&](const value_tape& tape, int worker) {
+            value_tape::cursor c = tape.replay();
+            return evaluate(c, stacks[worker]);
+        }, results);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::setw(3) << threads << std::setw(11) << std::left << " threads" << std::right
+                  << std::setw(9) << secs * 1e3 << " ms\n";
+        if (results != expected) {
+            std::cout << "MISMATCH with " << threads << " threads\n";
+            return 1;
+        }
+    }
+    return 0;
+}
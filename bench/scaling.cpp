@@ -0,0 +1,235 @@
+// How recognition time and Earley items grow with the input, for the
+// recursion shapes in this repo's grammars.
+//
+//   ./bench-scaling [scale]
+//
+// Every shape is recognized on inputs that double in size, from its first
+// size times `scale`. The growth order is the least-squares slope of
+// log(time) and log(Earley items) against log(tokens). A shape that grows
+// faster than Marpa promises for it, plus 0.25 for timer noise, is
+// flagged and the exit status is 1, so a change to a grammar or to
+// marpa.hpp that turns linear parsing super-linear shows up here.
+//
+// The grammars are built with the same calls the generated
+// create_grammar() makes.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "../marpa-cpp/marpa.hpp"
+
+using namespace marpa;
+
+typedef std::vector<grammar::symbol_id> symbols;
+
+struct shape {
+    const char* name;
+    const char* rule;
+    bool        leo;
+    double      items_order;   // what Marpa promises for all Earley items
+    double      time_order;
+    int         first_size;    // in repetitions of the input unit
+    int         sizes;
+    void (*build)(grammar& g, symbols& terminals);
+    void (*input)(int n, const symbols& terminals, symbols& tokens);
+};
+
+// balanced.txt
+void build_balanced(grammar& g, symbols& t) {
+    grammar::symbol_id expr = g.new_symbol(), parens = g.new_symbol();
+    grammar::symbol_id lp = g.new_symbol(), rp = g.new_symbol();
+    g.add_rule(expr, { parens });
+    g.add_rule(parens, { lp, parens, rp });
+    g.add_rule(parens, {});
+    g.start_symbol(expr);
+    t = { lp, rp };
+}
+
+void input_balanced(int n, const symbols& t, symbols& tokens) {
+    tokens.assign(n, t[0]);
+    tokens.insert(tokens.end(), n, t[1]);
+}
+
+// rules3: a file is a sequence of `name ::= name` rules
+void build_sequence(grammar& g, symbols& t) {
+    grammar::symbol_id rules = g.new_symbol(), rule = g.new_symbol();
+    grammar::symbol_id name = g.new_symbol(), op = g.new_symbol();
+    g.add_sequence(rules, rule, -1, 1, 0);
+    g.add_rule(rule, { name, op, name });
+    g.start_symbol(rules);
+    t = { name, op };
+}
+
+void input_sequence(int n, const symbols& t, symbols& tokens) {
+    tokens.clear();
+    for (int i = 0; i < n; ++i) {
+        tokens.push_back(t[0]);
+        tokens.push_back(t[1]);
+        tokens.push_back(t[0]);
+    }
+}
+
+void build_left(grammar& g, symbols& t) {
+    grammar::symbol_id list = g.new_symbol(), item = g.new_symbol();
+    g.add_rule(list, { list, item });
+    g.add_rule(list, { item });
+    g.start_symbol(list);
+    t = { item };
+}
+
+void build_right(grammar& g, symbols& t) {
+    grammar::symbol_id list = g.new_symbol(), item = g.new_symbol();
+    g.add_rule(list, { item, list });
+    g.add_rule(list, { item });
+    g.start_symbol(list);
+    t = { item };
+}
+
+void input_items(int n, const symbols& t, symbols& tokens) {
+    tokens.assign(n, t[0]);
+}
+
+// calc.txt before %left, ambiguous
+void build_ambiguous_calc(grammar& g, symbols& t) {
+    grammar::symbol_id expr = g.new_symbol(), term = g.new_symbol(), factor = g.new_symbol();
+    grammar::symbol_id add = g.new_symbol(), sub = g.new_symbol(), mul = g.new_symbol();
+    grammar::symbol_id number = g.new_symbol();
+    g.add_rule(expr, { term });
+    g.add_rule(term, { term, add, term });
+    g.add_rule(term, { term, sub, term });
+    g.add_rule(term, { factor });
+    g.add_rule(factor, { factor, mul, factor });
+    g.add_rule(factor, { number });
+    g.start_symbol(expr);
+    t = { number, add, sub, mul };
+}
+
+// calc.txt as the generator rewrites it for `%left add sub` and `%left mul`
+void build_calc(grammar& g, symbols& t) {
+    grammar::symbol_id expr = g.new_symbol(), term = g.new_symbol(), factor = g.new_symbol();
+    grammar::symbol_id term_level1 = g.new_symbol(), factor_level1 = g.new_symbol();
+    grammar::symbol_id add = g.new_symbol(), sub = g.new_symbol(), mul = g.new_symbol();
+    grammar::symbol_id number = g.new_symbol();
+    g.add_rule(expr, { term });
+    g.add_rule(term, { term, add, term_level1 });
+    g.add_rule(term, { term, sub, term_level1 });
+    g.add_rule(term, { term_level1 });
+    g.add_rule(term_level1, { factor });
+    g.add_rule(factor, { factor, mul, factor_level1 });
+    g.add_rule(factor, { factor_level1 });
+    g.add_rule(factor_level1, { number });
+    g.start_symbol(expr);
+    t = { number, add, sub, mul };
+}
+
+void input_calc(int n, const symbols& t, symbols& tokens) {
+    srand(1);
+    tokens.assign(1, t[0]);
+    for (int i = 1; i < n; ++i) {
+        tokens.push_back(t[1 + rand() % 3]);
+        tokens.push_back(t[0]);
+    }
+}
+
+const shape shapes[] = {
+    { "balanced.txt",    "parens ::= lp parens rp",       true,  1, 1, 1000, 7, build_balanced,       input_balanced },
+    { "rules3",          "rules ::= rule+",               true,  1, 1, 1000, 7, build_sequence,       input_sequence },
+    { "left recursion",  "list ::= list item",            true,  1, 1, 2000, 7, build_left,           input_items },
+    { "right recursion", "list ::= item list",            true,  1, 1, 2000, 7, build_right,          input_items },
+    { "right, no Leo",   "list ::= item list",            false, 2, 2, 250,  5, build_right,          input_items },
+    { "ambiguous calc",  "term ::= term add term",        true,  2, 3, 25,   5, build_ambiguous_calc, input_calc },
+    { "calc.txt",        "term ::= term add term_level1", true,  1, 1, 1000, 7, build_calc,           input_calc },
+};
+
+struct measurement {
+    size_t tokens;
+    double secs;     // per recognition
+    double items;    // all Earley sets
+};
+
+// Recognizes the tokens often enough to take at least 20ms in total.
+bool measure(grammar& g, bool leo, const symbols& tokens, measurement& m) {
+    typedef std::chrono::steady_clock clock_type;
+    m.tokens = tokens.size();
+
+    int runs = 0;
+    auto start = clock_type::now();
+    double secs;
+    do {
+        recognizer r(g, leo);
+        double items = r.earley_set_size(r.latest_earley_set());
+        for (grammar::symbol_id t : tokens) {
+            if (r.alternative(t, 1, 1) != MARPA_ERR_NONE || r.earleme_complete() < 0) return false;
+            items += r.earley_set_size(r.latest_earley_set());
+        }
+        m.items = items;
+        ++runs;
+        secs = std::chrono::duration<double>(clock_type::now() - start).count();
+    } while (secs < 0.02);
+    m.secs = secs / runs;
+    return true;
+}
+
+// Least-squares slope of log(y) over log(tokens).
+template <class F>
+double growth_order(const std::vector<measurement>& ms, F y) {
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const measurement& m : ms) {
+        double lx = std::log(double(m.tokens)), ly = std::log(y(m));
+        sx += lx;  sy += ly;  sxx += lx * lx;  sxy += lx * ly;
+    }
+    double n = ms.size();
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+int main(int argc, char** argv) {
+    double scale = argc > 1 ? atof(argv[1]) : 1;
+    const double tolerance = 0.25;
+    int flagged = 0;
+
+    for (const shape& s : shapes) {
+        grammar g;
+        symbols terminals;
+        s.build(g, terminals);
+        if (g.precompute() < 0) {
+            std::cout << s.name << ": precompute failed, error " << g.error() << "\n";
+            return 1;
+        }
+
+        std::cout << s.name << "  " << s.rule << (s.leo ? "" : "  (Leo off)") << "\n"
+                  << "      tokens     ms/parse  items/token\n";
+
+        std::vector<measurement> ms;
+        symbols tokens;
+        for (int i = 0; i < s.sizes; ++i) {
+            int n = std::max(1, int(s.first_size * scale)) << i;
+            s.input(n, terminals, tokens);
+            measurement m;
+            if (!measure(g, s.leo, tokens, m)) {
+                std::cout << "  input rejected at size " << n << "\n";
+                return 1;
+            }
+            ms.push_back(m);
+            std::cout << std::setw(12) << m.tokens << std::fixed << std::setprecision(3)
+                      << std::setw(13) << m.secs * 1e3 << std::setprecision(2)
+                      << std::setw(13) << m.items / m.tokens << "\n";
+        }
+
+        double t = growth_order(ms, [](const measurement& m) { return m.secs; });
+        double e = growth_order(ms, [](const measurement& m) { return m.items; });
+        bool bad = t > s.time_order + tolerance || e > s.items_order + tolerance;
+        flagged += bad;
+        std::cout << std::setprecision(2) << "  order: time " << t << " (expected " << s.time_order
+                  << "), items " << e << " (expected " << s.items_order << ")"
+                  << (bad ? "  SUPER-LINEAR" : "") << "\n\n";
+    }
+
+    if (flagged) {
+        std::cout << flagged << " shape(s) grow faster than expected\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+// The number scanners of util.h: checked against strtoll/strtoull on
+// random input, then timed against parse_digit and strtol.
+//
+//   ./bench-scan-numbers [fuzz-cases] [megabytes]
+//
+// The fuzz inputs are exactly sized heap buffers, so building with
+// -fsanitize=address also catches reads past the end.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include "../util.h"
+
+long failures = 0;
+
+template <class N>
+void check(const char* what, const std::string& s, scan_status status, size_t used, N value,
+           bool ok, bool range, size_t expect_used, N expect) {
+    scan_status expect_status = expect_used == 0 ? SCAN_NO_DIGITS : !ok || !range ? SCAN_OVERFLOW : SCAN_OK;
+    if (expect_status != SCAN_OK) expect = 0;
+    if (status != expect_status || used != expect_used || value != expect) {
+        if (++failures <= 10) {
+            std::cout << what << " \"" << s << "\": status " << status << " used " << used << " value " << value
+                      << ", expected " << expect_status << " " << expect_used << " " << expect << "\n";
+        }
+    }
+}
+
+// Checks every scanner that applies to a string in `base`.
+void check_all(const std::string& s, int base) {
+    std::vector<char> buf(s.begin(), s.end());     // no terminator
+    const char* first = buf.data();
+    const char* last  = first + buf.size();
+    const char* c     = s.c_str();
+    char* end;
+
+    bool signed_input = !s.empty() && (s[0] == '-' || s[0] == '+');
+
+    errno = 0;
+    long long sv = strtoll(c, &end, base);
+    bool sok = errno != ERANGE;
+    size_t sused = end - c;
+
+    if (!signed_input) {
+        errno = 0;
+        unsigned long long uv = strtoull(c, &end, base);
+        bool uok = errno != ERANGE;
+        size_t uused = end - c;
+
+        auto u32 = scan_unsigned<uint32_t>(first, last, base);
+        check("scan_unsigned<uint32_t>", s, u32.status, u32.next - first, u32.value,
+              uok, uv <= UINT32_MAX, uused, uint32_t(uv));
+        auto u64 = scan_unsigned<uint64_t>(s.begin(), s.end(), base);
+        check("scan_unsigned<uint64_t>", s, u64.status, u64.next - s.begin(), u64.value,
+              uok, true, uused, uint64_t(uv));
+        auto i32 = scan_unsigned<int>(first, last, base);
+        check("scan_unsigned<int>", s, i32.status, i32.next - first, i32.value,
+              uok, uv <= INT_MAX, uused, int(uv));
+        if (base == 10) {
+            auto d32 = scan_decimal<int>(first, last);
+            check("scan_decimal<int>", s, d32.status, d32.next - first, d32.value,
+                  uok, uv <= INT_MAX, uused, int(uv));
+            auto du32 = scan_decimal<uint32_t>(first, last);
+            check("scan_decimal<uint32_t>", s, du32.status, du32.next - first, du32.value,
+                  uok, uv <= UINT32_MAX, uused, uint32_t(uv));
+            auto du64 = scan_decimal<uint64_t>(first, last);
+            check("scan_decimal<uint64_t>", s, du64.status, du64.next - first, du64.value,
+                  uok, true, uused, uint64_t(uv));
+            auto d16 = scan_decimal<uint16_t>(first, last);
+            check("scan_decimal<uint16_t>", s, d16.status, d16.next - first, d16.value,
+                  uok, uv <= UINT16_MAX, uused, uint16_t(uv));
+        }
+        if (base == 16) {
+            auto h = scan_hex<uint64_t>(first, last);
+            check("scan_hex<uint64_t>", s, h.status, h.next - first, h.value, uok, true, uused, uint64_t(uv));
+        }
+        if (base == 8) {
+            auto o = scan_octal<uint32_t>(first, last);
+            check("scan_octal<uint32_t>", s, o.status, o.next - first, o.value,
+                  uok, uv <= UINT32_MAX, uused, uint32_t(uv));
+        }
+        if (base <= 10) {
+            // must stop at a digit outside the base instead of spinning
+            auto p = parse_digit(first, last, unsigned(base), '0');
+            if (p.first - first != (ptrdiff_t)uused) {
+                if (++failures <= 10) std::cout << "parse_digit \"" << s << "\" stops at " << p.first - first << "\n";
+            }
+        }
+    }
+
+    auto s32 = scan_signed<int>(first, last, base);
+    check("scan_signed<int>", s, s32.status, s32.next - first, s32.value,
+          sok, sv >= INT_MIN && sv <= INT_MAX, sused, int(sv));
+    auto s64 = scan_signed<int64_t>(s.begin(), s.end(), base);
+    check("scan_signed<int64_t>", s, s64.status, s64.next - s.begin(), s64.value,
+          sok, true, sused, int64_t(sv));
+    auto s64p = scan_signed<int64_t>(first, last, base);
+    check("scan_signed<int64_t>", s, s64p.status, s64p.next - first, s64p.value,
+          sok, true, sused, int64_t(sv));
+}
+
+std::string random_case(int base) {
+    static const char* limits[] = {
+        "2147483647", "2147483648", "4294967295", "4294967296",
+        "9223372036854775807", "9223372036854775808",
+        "18446744073709551615", "18446744073709551616",
+        "7fffffff", "80000000", "ffffffff", "100000000", "ffffffffffffffff", "10000000000000000",
+        "17777777777", "20000000000", "37777777777", "40000000000",
+    };
+    // no spaces or x: strtol skips leading space and reads "0x" as a prefix
+    static const char garbage[] = ",;+-.gzZ~";
+    static const char digits[]  = "0123456789abcdefghijklmnopqrstuvwyzA";
+
+    std::string s;
+    int sign = rand() % 4;
+    if (sign == 1) s += '-';
+    if (sign == 2) s += '+';
+    if (rand() % 4 == 0) {
+        s += limits[rand() % (sizeof limits / sizeof *limits)];
+    }
+    else {
+        int zeros = rand() % 8 == 0 ? rand() % 12 : 0;
+        s.append(zeros, '0');
+        int n = rand() % 24;
+        for (int i = 0; i < n; ++i) s += digits[rand() % base];
+    }
+    int tail = rand() % 3;
+    for (int i = 0; i < tail; ++i) s += garbage[rand() % (sizeof garbage - 1)];
+    if (rand() % 4 == 0) s += digits[rand() % 36];
+    return s;
+}
+
+typedef std::chrono::steady_clock clock_type;
+
+template <class F>
+void run(const char* name, const std::string& input, size_t count, F f) {
+    const char* first = input.data();
+    const char* last  = first + input.size();
+    auto start = clock_type::now();
+    uint64_t sum = 0;
+    size_t n = 0;
+    while (first < last) {
+        sum += f(first, last);
+        ++first;   // the space
+        ++n;
+    }
+    double secs = std::chrono::duration<double>(clock_type::now() - start).count();
+    std::cout << std::setw(26) << std::left << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(7) << n / secs / 1e6 << " Mnumbers/s  " << std::setw(7) << input.size() / secs / 1e6
+              << " MB/s  sum " << sum << (n == count ? "" : "  COUNT MISMATCH") << "\n";
+}
+
+std::string make_numbers(size_t size, int min_digits, int max_digits, size_t& count) {
+    std::string s;
+    s.reserve(size + 32);
+    count = 0;
+    while (s.size() < size) {
+        int digits = min_digits + rand() % (max_digits - min_digits + 1);
+        s += char('1' + rand() % 9);
+        for (int i = 1; i < digits; ++i) s += char('0' + rand() % 10);
+        s += ' ';
+        ++count;
+    }
+    return s;
+}
+
+int main(int argc, char** argv) {
+    long   cases     = argc > 1 ? atol(argv[1]) : 200000;
+    size_t megabytes = argc > 2 ? atol(argv[2]) : 64;
+
+    srand(1);
+    static const int bases[] = { 10, 10, 16, 8, 2, 36 };
+    for (long i = 0; i < cases; ++i) {
+        int base = bases[i % 6];
+        check_all(random_case(base), base);
+    }
+    std::cout << cases << " fuzz cases, " << failures << " failures\n";
+
+    size_t count;
+    std::string input = make_numbers(megabytes << 20, 1, 9, count);
+    std::cout << "\n1 to 9 digits, " << count << " numbers\n";
+    run("parse_digit", input, count, [](const char*& p, const char* last) {
+        auto r = parse_digit(p, last, 10, '0');
+        p = r.first;
+        return r.second;
+    });
+    run("strtol", input, count, [](const char*& p, const char*) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        p = end;
+        return v;
+    });
+    run("scan_unsigned<int>", input, count, [](const char*& p, const char* last) {
+        auto r = scan_unsigned<int>(p, last, 10);
+        p = r.next;
+        return r.value;
+    });
+    run("scan_decimal<int>", input, count, [](const char*& p, const char* last) {
+        auto r = scan_decimal<int>(p, last);
+        p = r.next;
+        return r.value;
+    });
+
+    input = make_numbers(megabytes << 20, 12, 18, count);
+    std::cout << "\n12 to 18 digits, " << count << " numbers\n";
+    run("strtoll", input, count, [](const char*& p, const char*) {
+        char* end;
+        long long v = strtoll(p, &end, 10);
+        p = end;
+        return v;
+    });
+    run("scan_signed<int64_t>", input, count, [](const char*& p, const char* last) {
+        auto r = scan_signed<int64_t>(p, last);
+        p = r.next;
+        return r.value;
+    });
+    run("scan_decimal<uint64_t>", input, count, [](const char*& p, const char* last) {
+        auto r = scan_decimal<uint64_t>(p, last);
+        p = r.next;
+        return r.value;
+    });
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+// Build/clear cycles of tree.hh trees with std::allocator and with
+// tree_pool_allocator.
+//
+//   ./bench-tree-pool [nodes] [cycles]
+//
+// Each cycle grows a tree by appending under random existing nodes,
+// erases a few subtrees (so the free list is used) and clears it.
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../tree.hh"
+#include "../tree_pool.hh"
+
+struct node {
+    int type;
+    int val;
+};
+
+template <class Tree>
+void run(const char* name, int nodes, int cycles) {
+    Tree t;
+    std::vector<typename Tree::iterator> its;
+    its.reserve(nodes);
+    long checksum = 0;
+
+    srand(1);
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; ++c) {
+        its.clear();
+        its.push_back(t.set_head(node{ 0, 0 }));
+        for (int i = 1; i < nodes; ++i) {
+            its.push_back(t.append_child(its[rand() % its.size()], node{ 1, i }));
+        }
+        for (int i = 0; i < 8; ++i) {
+            auto leaf = its[its.size() - 1 - i];
+            if (t.number_of_children(leaf) == 0) {
+                t.erase(leaf);
+            }
+        }
+        for (int i = 0; i < nodes / 16; ++i) {
+            t.append_child(its[rand() % (its.size() - 8)], node{ 2, i });
+        }
+        checksum += t.size();
+        t.clear();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::setw(20) << std::left << name << std::right << std::fixed << std::setprecision(3)
+              << secs << "s  " << std::setprecision(1) << (double(nodes) * cycles / secs / 1e6)
+              << " Mnodes/s  checksum " << checksum << "\n";
+}
+
+int main(int argc, char** argv) {
+    int nodes  = argc > 1 ? atoi(argv[1]) : 100000;
+    int cycles = argc > 2 ? atoi(argv[2]) : 50;
+
+    run<tree<node> >("std::allocator", nodes, cycles);
+    run<tree<node, tree_pool_allocator<tree_node_<node> > > >("pool", nodes, cycles);
+    run<tree<node, tree_pool_allocator<tree_node_<node>, true> > >("pool, huge pages", nodes, cycles);
+}
@@ -0,0 +1,148 @@
+// Valuation of a punctuation-heavy expression with every symbol valued,
+// as set_valued_rules() left it, against the set_valued() the generator
+// now emits: operators, parentheses and pass-through symbols unvalued.
+//
+//   ./bench-valued [tokens]
+//
+// The grammar is calctree.txt's after the %left rewrite. Both runs must
+// compute the same value.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../marpa-cpp/marpa.hpp"
+
+using namespace marpa;
+
+grammar::symbol_id expr, term, term_level1, factor, factor_level1, add, mul, number, LB, RB;
+grammar::rule_id   add_rule_id, mul_rule_id, parens_rule_id;
+
+void build(grammar& g) {
+    expr = g.new_symbol();  term = g.new_symbol();  term_level1 = g.new_symbol();
+    factor = g.new_symbol();  factor_level1 = g.new_symbol();
+    add = g.new_symbol();  mul = g.new_symbol();  number = g.new_symbol();
+    LB = g.new_symbol();  RB = g.new_symbol();
+
+    g.add_rule(expr, { term });
+    add_rule_id = g.add_rule(term, { term, add, term_level1 });
+    g.add_rule(term, { term_level1 });
+    g.add_rule(term_level1, { factor });
+    mul_rule_id = g.add_rule(factor, { factor, mul, factor_level1 });
+    g.add_rule(factor, { factor_level1 });
+    g.add_rule(factor_level1, { number });
+    parens_rule_id = g.add_rule(factor_level1, { LB, expr, RB });
+    g.start_symbol(expr);
+}
+
+// ((1+2)*(3+(4*5))+...), about half of it punctuation
+void generate(size_t n, std::vector<grammar::symbol_id>& tokens, std::vector<int>& values) {
+    int depth = 0;
+    while (tokens.size() < n || depth > 0) {
+        if (tokens.size() < n && rand() % 3 == 0) {
+            tokens.push_back(LB);
+            ++depth;
+            continue;
+        }
+        tokens.push_back(number);
+        values.push_back(1 + rand() % 9);
+        while (depth > 0 && rand() % 3 == 0) {
+            tokens.push_back(RB);
+            --depth;
+        }
+        if (tokens.size() < n || depth > 0) {
+            tokens.push_back(rand() % 2 ? add : mul);
+        }
+    }
+}
+
+struct steps {
+    long tokens = 0, rules = 0;
+    int  result = 0;
+};
+
+steps valuate(grammar& g, recognizer& r, bool all_valued) {
+    bocage b{r, r.latest_earley_set()};
+    order o{b};
+    tree t{o};
+    t.next();
+    value v{t};
+
+    if (all_valued) {
+        g.set_valued_rules(v);
+        for (grammar::symbol_id s : { add, mul, number, LB, RB }) v.symbol_is_valued(s, 1);
+    }
+    else {
+        // as valued_symbols() in marpa.txt: expr and term_level1 only pass
+        // their one symbol on, factor_level1 has the parens rule
+        for (grammar::symbol_id s : { term, factor, factor_level1, number }) v.symbol_is_valued(s, 1);
+        for (grammar::symbol_id s : { expr, term_level1, add, mul, LB, RB }) v.symbol_is_valued(s, 0);
+    }
+
+    steps n;
+    std::vector<int> stack(1024);
+    for (;;) {
+        value::step_type type = v.step();
+        if (type == MARPA_STEP_INACTIVE) break;
+        if (size_t(v.result()) + 3 >= stack.size()) stack.resize(2 * stack.size());
+        if (type == MARPA_STEP_TOKEN) {
+            ++n.tokens;
+            stack[v.result()] = v.token_value();
+        }
+        else if (type == MARPA_STEP_RULE) {
+            ++n.rules;
+            grammar::rule_id rule = v.rule();
+            int a = v.arg_0();
+            if      (rule == add_rule_id)    stack[v.result()] = (stack[a] + stack[a + 2]) % 1000003;
+            else if (rule == mul_rule_id)    stack[v.result()] = (long long)stack[a] * stack[a + 2] % 1000003;
+            else if (rule == parens_rule_id) stack[v.result()] = stack[a + 1];
+            else                             stack[v.result()] = stack[a];
+        }
+    }
+    n.result = stack[0];
+    return n;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? atol(argv[1]) : 1000000;
+
+    grammar g;
+    build(g);
+    if (g.precompute() < 0) {
+        std::cout << "precompute failed, error " << g.error() << "\n";
+        return 1;
+    }
+
+    srand(1);
+    std::vector<grammar::symbol_id> tokens;
+    std::vector<int> values;
+    generate(n, tokens, values);
+
+    recognizer r(g);
+    size_t next_value = 0;
+    for (grammar::symbol_id s : tokens) {
+        int value = s == number ? values[next_value++] : 1;
+        if (r.alternative(s, value, 1) != MARPA_ERR_NONE || r.earleme_complete() < 0) {
+            std::cout << "input rejected\n";
+            return 1;
+        }
+    }
+    std::cout << tokens.size() << " tokens, " << values.size() << " numbers\n";
+
+    int result[2];
+    for (int all = 1; all >= 0; --all) {
+        auto start = std::chrono::steady_clock::now();
+        steps s = valuate(g, r, all);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result[all] = s.result;
+        std::cout << std::setw(14) << std::left << (all ? "all valued" : "set_valued") << std::right
+                  << std::setw(10) << s.tokens << " token steps" << std::setw(10) << s.rules << " rule steps"
+                  << std::fixed << std::setprecision(1) << std::setw(9) << secs * 1e3 << " ms\n";
+    }
+    if (result[0] != result[1]) {
+        std::cout << "MISMATCH " << result[0] << " " << result[1] << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef DIFF_AST_H
+#define DIFF_AST_H
+
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+enum expr_kind {
+    EXPR_NONE = 0,
+    EXPR_NUMBER,
+    EXPR_X,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_POWER,
+};
+
+const char* const expr_op_names[] = {
+    0, 0, 0, "+", "-", "*", "/", "^",
+};
+
+struct expr_node {
+    uint8_t  kind;
+    int32_t  value;   // EXPR_NUMBER
+    uint32_t left;
+    uint32_t right;
+};
+
+// Writes the expression at `root` of any node container with
+// operator[](uint32_t) -> expr_node, fully parenthesized. Iterative, so
+// left-deep trees of any size are fine.
+template <class Nodes>
+void show_expr(const Nodes& nodes, uint32_t root, std::ostream& out) {
+    struct frame { uint32_t i; int state; };
+    std::vector<frame> todo;
+    todo.push_back(frame{ root, 0 });
+
+    while (!todo.empty()) {
+        frame& f = todo.back();
+        const expr_node& n = nodes[f.i];
+
+        if (n.kind == EXPR_NUMBER) {
+            out << n.value;
+            todo.pop_back();
+        }
+        else if (n.kind == EXPR_X) {
+            out << 'x';
+            todo.pop_back();
+        }
+        else if (f.state == 0) {
+            out << '(';
+            f.state = 1;
+            todo.push_back(frame{ n.left, 0 });
+        }
+        else if (f.state == 1) {
+            out << ' ' << expr_op_names[n.kind] << ' ';
+            f.state = 2;
+            todo.push_back(frame{ n.right, 0 });
+        }
+        else {
+            out << ')';
+            todo.pop_back();
+        }
+    }
+}
+
+// All nodes of one parse live in a single vector and refer to each other
+// by index. Index 0 is never handed out, so an index can be used as a
+// Marpa token value.
+class expr_arena {
+    public:
+        typedef uint32_t index;
+    public:
+        expr_arena() { clear(); }
+
+        index number(int n)  { return add(EXPR_NUMBER, n, 0, 0); }
+        index x()            { return add(EXPR_X, 0, 0, 0); }
+        index op(expr_kind kind, index left, index right) {
+            return add(kind, 0, left, right);
+        }
+
+        const expr_node& operator[](index i) const { return nodes[i]; }
+        size_t size() const { return nodes.size(); }
+
+        void reserve(size_t n) { nodes.reserve(n + 1); }
+
+        // Nodes created after mark() are dropped by release(); used to keep
+        // the token nodes while evaluating more than one parse tree.
+        size_t mark() const        { return nodes.size(); }
+        void   release(size_t m)   { nodes.resize(m); }
+        void   clear()             { nodes.resize(1); nodes[0] = expr_node{ EXPR_NONE, 0, 0, 0 }; }
+
+        // Writes the expression fully parenthesized, like the old show().
+        void show(index root, std::ostream& out) const {
+            show_expr(*this, root, out);
+        }
+    private:
+        index add(int kind, int value, index left, index right) {
+            nodes.push_back(expr_node{ uint8_t(kind), value, left, right });
+            return nodes.size() - 1;
+        }
+    private:
+        std::vector<expr_node> nodes;
+};
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef DIFF_DAG_H
+#define DIFF_DAG_H
+
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+#include <stdint.h>
+#include "diff_ast.h"
+
+// Expressions in x as a hash-consed DAG: make() returns the existing node
+// for a structurally equal expression, so every distinct subterm is
+// stored once and equal subterms compare equal by index.
+//
+// Every node is simplified when it is made: constants are folded (as
+// long as the result stays an exact int32) and
+//
+//   e + 0 = e     e - 0 = e     e * 1 = e     e / 1 = e     e ^ 1 = e
+//   e * 0 = 0     e - e = 0     e / e = 1     e ^ 0 = 1     0 / e = 0
+//   e + e = 2 * e               c1 * (c2 * e) = (c1 c2) * e
+//   (e ^ m) ^ n = e ^ (m n)
+//
+// Operands of + and * are put in a canonical order, numbers first, so
+// a + b and b + a are the same node. Like the rest of diff, e / e and
+// 0 / e assume e is not zero.
+//
+// derivative() is memoized per node, so the k-th derivative only adds
+// the subterms that are new since the (k-1)-th.
+class expr_dag {
+    public:
+        typedef uint32_t index;
+    public:
+        expr_dag() {
+            nodes.push_back(expr_node{ EXPR_NONE, 0, 0, 0 });
+            derivatives.push_back(0);
+        }
+
+        index number(int n)  { return intern(EXPR_NUMBER, n, 0, 0); }
+        index x()            { return intern(EXPR_X, 0, 0, 0); }
+        index power(index base, int n) { return make(EXPR_POWER, base, number(n)); }
+
+        // A simplified, shared node for `left kind right`. For EXPR_POWER
+        // `right` is a number node.
+        index make(expr_kind kind, index left, index right) {
+            // copied: number() may grow `nodes`
+            expr_node l = nodes[left];
+            expr_node r = nodes[right];
+            bool ln = l.kind == EXPR_NUMBER, rn = r.kind == EXPR_NUMBER;
+            int64_t folded;
+
+            switch (kind) {
+                case EXPR_ADD:
+                    if (ln && rn && fits(folded = int64_t(l.value) + r.value)) return number(folded);
+                    if (is(left, 0))  return right;
+                    if (is(right, 0)) return left;
+                    if (left == right) return make(EXPR_MUL, number(2), left);
+                    return intern_commutative(kind, left, right);
+                case EXPR_SUB:
+                    if (ln && rn && fits(folded = int64_t(l.value) - r.value)) return number(folded);
+                    if (is(right, 0))  return left;
+                    if (left == right) return number(0);
+                    break;
+                case EXPR_MUL: {
+                    if (ln && rn && fits(folded = int64_t(l.value) * r.value)) return number(folded);
+                    if (is(left, 0) || is(right, 0)) return number(0);
+                    if (is(left, 1))  return right;
+                    if (is(right, 1)) return left;
+                    if (left == right) return power(left, 2);
+                    // c1 * (c2 * e)
+                    index c = ln ? left : rn ? right : 0;
+                    index e = ln ? right : left;
+                    if (c && nodes[e].kind == EXPR_MUL && nodes[nodes[e].left].kind == EXPR_NUMBER
+                            && fits(folded = int64_t(nodes[c].value) * nodes[nodes[e].left].value)) {
+                        index rest = nodes[e].right;
+                        return make(EXPR_MUL, number(folded), rest);
+                    }
+                    return intern_commutative(kind, left, right);
+                }
+                case EXPR_DIV:
+                    if (ln && rn && r.value != 0 && int64_t(l.value) % r.value == 0
+                            && fits(folded = int64_t(l.value) / r.value)) {
+                        return number(folded);
+                    }
+                    if (is(left, 0) && !is(right, 0)) return left;
+                    if (is(right, 1)) return left;
+                    if (left == right && !is(right, 0)) return number(1);
+                    break;
+                case EXPR_POWER: {
+                    int n = r.value;
+                    if (n == 0) return number(1);
+                    if (n == 1) return left;
+                    if (ln && n > 0) {
+                        int64_t p = 1;
+                        int k = 0;
+                        while (k < n && fits(p * l.value)) {
+                            p *= l.value;
+                            ++k;
+                        }
+                        if (k == n) return number(p);
+                    }
+                    if (l.kind == EXPR_POWER && fits(folded = int64_t(nodes[l.right].value) * n)) {
+                        return power(l.left, folded);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            return intern(kind, 0, left, right);
+        }
+
+        // Copies a parse tree into the DAG, simplifying on the way.
+        // Iterative, like expr_arena::show().
+        index import(const expr_arena& ast, expr_arena::index root) {
+            std::vector<index> done(ast.size(), 0);
+            std::vector<expr_arena::index> todo;
+            todo.push_back(root);
+
+            while (!todo.empty()) {
+                expr_arena::index i = todo.back();
+                const expr_node& n = ast[i];
+                if (done[i]) {
+                    todo.pop_back();
+                    continue;
+                }
+                if (n.kind == EXPR_NUMBER) {
+                    done[i] = number(n.value);
+                }
+                else if (n.kind == EXPR_X) {
+                    done[i] = x();
+                }
+                else if (!done[n.left] || !done[n.right]) {
+                    if (!done[n.left])  todo.push_back(n.left);
+                    if (!done[n.right]) todo.push_back(n.right);
+                    continue;
+                }
+                else {
+                    done[i] = make(expr_kind(n.kind), done[n.left], done[n.right]);
+                }
+                todo.pop_back();
+            }
+            return done[root];
+        }
+
+        // d/dx of the node at `root`.
+        index derivative(index root) {
+            std::vector<index> todo;
+            todo.push_back(root);
+
+            while (!todo.empty()) {
+                index i = todo.back();
+                if (derivatives[i]) {
+                    todo.pop_back();
+                    continue;
+                }
+                // copied: make() may grow `nodes`
+                expr_node n = nodes[i];
+                index d = 0;
+
+                switch (n.kind) {
+                    case EXPR_NUMBER:
+                        d = number(0);
+                        break;
+                    case EXPR_X:
+                        d = number(1);
+                        break;
+                    case EXPR_POWER:
+                        if (!derivatives[n.left]) {
+                            todo.push_back(n.left);
+                            continue;
+                        }
+                        // n u^(n-1) u'
+                        {
+                            index du = derivatives[n.left];
+                            int   k  = nodes[n.right].value;
+                            d = make(EXPR_MUL, make(EXPR_MUL, number(k), power(n.left, k - 1)), du);
+                        }
+                        break;
+                    default: {
+                        if (!derivatives[n.left] || !derivatives[n.right]) {
+                            if (!derivatives[n.left])  todo.push_back(n.left);
+                            if (!derivatives[n.right]) todo.push_back(n.right);
+                            continue;
+                        }
+                        index dl = derivatives[n.left], dr = derivatives[n.right];
+                        if (n.kind == EXPR_ADD || n.kind == EXPR_SUB) {
+                            d = make(expr_kind(n.kind), dl, dr);
+                        }
+                        else if (n.kind == EXPR_MUL) {
+                            d = make(EXPR_ADD, make(EXPR_MUL, dl, n.right), make(EXPR_MUL, n.left, dr));
+                        }
+                        else {
+                            // (u' v - u v') / v^2
+                            d = make(EXPR_DIV,
+                                     make(EXPR_SUB, make(EXPR_MUL, dl, n.right), make(EXPR_MUL, n.left, dr)),
+                                     power(n.right, 2));
+                        }
+                    }
+                }
+                derivatives[i] = d;
+                todo.pop_back();
+            }
+            return derivatives[root];
+        }
+
+        const expr_node& operator[](index i) const { return nodes[i]; }
+
+        // Distinct nodes, including the unused node 0.
+        size_t size() const { return nodes.size(); }
+
+        // Nodes below `root` when written out as a tree, saturating at
+        // UINT64_MAX; compare with size() to see what sharing saves.
+        uint64_t tree_size(index root) const {
+            std::vector<uint64_t> count(nodes.size(), 0);
+            for (index i = 1; i <= root; ++i) {
+                const expr_node& n = nodes[i];
+                uint64_t c = 1;
+                if (n.kind != EXPR_NUMBER && n.kind != EXPR_X) {
+                    c = saturating_add(c, saturating_add(count[n.left], count[n.right]));
+                }
+                count[i] = c;
+            }
+            return count[root];
+        }
+
+        // Written out as a tree, so the output can be far larger than the DAG.
+        void show(index root, std::ostream& out) const {
+            show_expr(*this, root, out);
+        }
+    private:
+        struct node_hash {
+            size_t operator()(const expr_node& n) const {
+                uint64_t h = n.kind;
+                h = h * 0x9e3779b97f4a7c15ull ^ uint32_t(n.value);
+                h = h * 0x9e3779b97f4a7c15ull ^ n.left;
+                h = h * 0x9e3779b97f4a7c15ull ^ n.right;
+                return h ^ (h >> 29);
+            }
+        };
+        struct node_equal {
+            bool operator()(const expr_node& a, const expr_node& b) const {
+                return a.kind == b.kind && a.value == b.value && a.left == b.left && a.right == b.right;
+            }
+        };
+
+        static bool fits(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+        static uint64_t saturating_add(uint64_t a, uint64_t b) {
+            return a + b < a ? UINT64_MAX : a + b;
+        }
+
+        bool is(index i, int value) const {
+            return nodes[i].kind == EXPR_NUMBER && nodes[i].value == value;
+        }
+
+        index intern_commutative(expr_kind kind, index left, index right) {
+            bool ln = nodes[left].kind == EXPR_NUMBER, rn = nodes[right].kind == EXPR_NUMBER;
+            if (rn > ln || (rn == ln && right < left)) std::swap(left, right);
+            return intern(kind, 0, left, right);
+        }
+
+        index intern(int kind, int value, index left, index right) {
+            expr_node n = expr_node{ uint8_t(kind), value, left, right };
+            auto found = table.find(n);
+            if (found != table.end()) return found->second;
+            nodes.push_back(n);
+            derivatives.push_back(0);
+            index i = nodes.size() - 1;
+            table.emplace(n, i);
+            return i;
+        }
+    private:
+        std::vector<expr_node> nodes;
+        std::vector<index>     derivatives;   // 0 until computed
+        std::unordered_map<expr_node, index, node_hash, node_equal> table;
+};
+
+#endif
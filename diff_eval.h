@@ -0,0 +1,309 @@
+#ifndef DIFF_EVAL_H
+#define DIFF_EVAL_H
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include "diff_ast.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIFF_EVAL_AVX2 1
+#include <immintrin.h>
+#endif
+
+// An expression in x lowered to a register program, evaluated over arrays
+// of x a block at a time: every instruction runs over the whole block
+// before the next one starts, so the inner loops are plain SIMD loops.
+//
+//   expr_program p(ast, root);
+//   p.eval(xs, ys, n);       // double or float
+//
+// Register 0 holds the block of x. Registers are assigned Sethi-Ullman
+// style, the child that needs more registers is evaluated first, so
+// even long chains need only a few blocks of scratch space.
+enum expr_vop {
+    VOP_CONST,  // dst = c
+    VOP_ADD,    // dst = a + b
+    VOP_SUB,
+    VOP_MUL,
+    VOP_DIV,
+    VOP_POWI,   // dst = a ^ n, n >= 0
+};
+
+struct expr_vinstr {
+    uint8_t  op;
+    uint16_t dst;
+    uint16_t a;
+    uint16_t b;
+    int32_t  n;
+    double   c;
+};
+
+// Block-wide primitives, plain loops; the compiler vectorizes them for
+// the baseline instruction set.
+template <class T>
+struct expr_scalar_ops {
+    static void set(T* d, T c, size_t n)                      { for (size_t i = 0; i < n; ++i) d[i] = c; }
+    static void add(T* d, const T* a, const T* b, size_t n)   { for (size_t i = 0; i < n; ++i) d[i] = a[i] + b[i]; }
+    static void sub(T* d, const T* a, const T* b, size_t n)   { for (size_t i = 0; i < n; ++i) d[i] = a[i] - b[i]; }
+    static void mul(T* d, const T* a, const T* b, size_t n)   { for (size_t i = 0; i < n; ++i) d[i] = a[i] * b[i]; }
+    static void div(T* d, const T* a, const T* b, size_t n)   { for (size_t i = 0; i < n; ++i) d[i] = a[i] / b[i]; }
+};
+
+#ifdef DIFF_EVAL_AVX2
+// Compiled for AVX2 whatever the build flags are; only called after
+// __builtin_cpu_supports("avx2"). n is a multiple of 8.
+template <class T>
+struct expr_avx2_ops;
+
+#define DIFF_EVAL_AVX2_LOOP(T, W, V, LOAD, STORE, OP)                    \
+    for (size_t i = 0; i < n; i += W) {                                 \
+        V x = LOAD(a + i), y = LOAD(b + i);                             \
+        STORE(d + i, OP(x, y));                                         \
+    }
+
+template <>
+struct expr_avx2_ops<double> {
+    __attribute__((target("avx2"))) static void set(double* d, double c, size_t n) {
+        __m256d v = _mm256_set1_pd(c);
+        for (size_t i = 0; i < n; i += 4) _mm256_storeu_pd(d + i, v);
+    }
+    __attribute__((target("avx2"))) static void add(double* d, const double* a, const double* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(double, 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd)
+    }
+    __attribute__((target("avx2"))) static void sub(double* d, const double* a, const double* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(double, 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd)
+    }
+    __attribute__((target("avx2"))) static void mul(double* d, const double* a, const double* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(double, 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd)
+    }
+    __attribute__((target("avx2"))) static void div(double* d, const double* a, const double* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(double, 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd)
+    }
+};
+
+template <>
+struct expr_avx2_ops<float> {
+    __attribute__((target("avx2"))) static void set(float* d, float c, size_t n) {
+        __m256 v = _mm256_set1_ps(c);
+        for (size_t i = 0; i < n; i += 8) _mm256_storeu_ps(d + i, v);
+    }
+    __attribute__((target("avx2"))) static void add(float* d, const float* a, const float* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(float, 8, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_add_ps)
+    }
+    __attribute__((target("avx2"))) static void sub(float* d, const float* a, const float* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(float, 8, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_sub_ps)
+    }
+    __attribute__((target("avx2"))) static void mul(float* d, const float* a, const float* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(float, 8, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_mul_ps)
+    }
+    __attribute__((target("avx2"))) static void div(float* d, const float* a, const float* b, size_t n) {
+        DIFF_EVAL_AVX2_LOOP(float, 8, __m256, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_div_ps)
+    }
+};
+
+#undef DIFF_EVAL_AVX2_LOOP
+#endif
+
+class expr_program {
+    public:
+        enum { block = 512 };   // elements per register, a multiple of every SIMD width
+    public:
+        expr_program(const expr_arena& ast, expr_arena::index root) : n_registers(1) {
+            lower(ast, root);
+        }
+
+        size_t size() const      { return code.size(); }
+        int    registers() const { return n_registers; }
+        const std::vector<expr_vinstr>& instructions() const { return code; }
+
+        static bool has_avx2() {
+#ifdef DIFF_EVAL_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        }
+
+        // out[i] = f(x[i]) for i < n, with AVX2 when the CPU has it.
+        template <class T>
+        void eval(const T* x, T* out, size_t n) const {
+#ifdef DIFF_EVAL_AVX2
+            if (has_avx2()) {
+                run<T, expr_avx2_ops<T>>(x, out, n);
+                return;
+            }
+#endif
+            run<T, expr_scalar_ops<T>>(x, out, n);
+        }
+
+        template <class T>
+        void eval_scalar(const T* x, T* out, size_t n) const {
+            run<T, expr_scalar_ops<T>>(x, out, n);
+        }
+    private:
+        template <class T, class Ops>
+        void run(const T* x, T* out, size_t n) const {
+            std::vector<T> regs(size_t(n_registers) * block);
+            T* r = regs.data();
+
+            for (size_t first = 0; first < n; first += block) {
+                size_t m = std::min<size_t>(block, n - first);
+                memcpy(r, x + first, m * sizeof(T));
+                if (m < block) std::fill(r + m, r + block, T(0));
+
+                for (const expr_vinstr& in : code) {
+                    T* d = r + size_t(in.dst) * block;
+                    const T* a = r + size_t(in.a) * block;
+                    const T* b = r + size_t(in.b) * block;
+                    switch (in.op) {
+                        case VOP_CONST: Ops::set(d, T(in.c), block); break;
+                        case VOP_ADD:   Ops::add(d, a, b, block); break;
+                        case VOP_SUB:   Ops::sub(d, a, b, block); break;
+                        case VOP_MUL:   Ops::mul(d, a, b, block); break;
+                        case VOP_DIV:   Ops::div(d, a, b, block); break;
+                        case VOP_POWI:  powi<T, Ops>(d, a, in.n, r + size_t(in.b) * block); break;
+                    }
+                }
+
+                memcpy(out + first, r + size_t(result) * block, m * sizeof(T));
+            }
+        }
+
+        // Square and multiply; `tmp` is a scratch register.
+        template <class T, class Ops>
+        static void powi(T* d, const T* a, int n, T* tmp) {
+            memcpy(tmp, a, block * sizeof(T));
+            Ops::set(d, T(1), block);
+            while (n > 0) {
+                if (n & 1) Ops::mul(d, d, tmp, block);
+                n >>= 1;
+                if (n) Ops::mul(tmp, tmp, tmp, block);
+            }
+        }
+
+        // Registers a node needs, not counting register 0.
+        static int need_of(const expr_node& n, const std::vector<int>& need) {
+            switch (n.kind) {
+                case EXPR_X:      return 0;
+                case EXPR_NUMBER: return 1;
+                case EXPR_POWER:  return std::max(need[n.left], 1) + 1;   // + scratch
+                default: {
+                    int l = need[n.left], r = need[n.right];
+                    int first = std::max(l, r), second = std::min(l, r);
+                    bool held = (l >= r ? l : r) > 0;   // the first result takes a register
+                    return std::max(std::max(first, second + (held ? 1 : 0)), 1);
+                }
+            }
+        }
+
+        void lower(const expr_arena& ast, expr_arena::index root) {
+            // Registers needed per node, children first.
+            std::vector<int> need(ast.size(), 0);
+            {
+                struct frame { expr_arena::index i; bool done; };
+                std::vector<frame> todo;
+                todo.push_back(frame{ root, false });
+                while (!todo.empty()) {
+                    frame f = todo.back();
+                    todo.pop_back();
+                    const expr_node& n = ast[f.i];
+                    if (f.done || n.kind == EXPR_X || n.kind == EXPR_NUMBER) {
+                        need[f.i] = need_of(n, need);
+                        continue;
+                    }
+                    todo.push_back(frame{ f.i, true });
+                    todo.push_back(frame{ n.left, false });
+                    if (n.kind != EXPR_POWER) todo.push_back(frame{ n.right, false });
+                }
+            }
+
+            // Emit with the result of node i in a register >= d (or in
+            // register 0 for x).
+            struct frame {
+                expr_arena::index i;
+                int      d;
+                int      state;
+                int      first_loc;
+                bool     left_first;
+            };
+            std::vector<frame> todo;
+            std::vector<int>   locs;   // results of finished children
+            todo.push_back(frame{ root, 1, 0, 0, true });
+
+            while (!todo.empty()) {
+                frame& f = todo.back();
+                const expr_node& n = ast[f.i];
+
+                if (n.kind == EXPR_X) {
+                    locs.push_back(0);
+                    todo.pop_back();
+                    continue;
+                }
+                if (n.kind == EXPR_NUMBER) {
+                    emit(VOP_CONST, f.d, 0, 0, 0, n.value);
+                    locs.push_back(f.d);
+                    todo.pop_back();
+                    continue;
+                }
+                if (n.kind == EXPR_POWER) {
+                    if (f.state == 0) {
+                        f.state = 1;
+                        todo.push_back(frame{ n.left, f.d, 0, 0, true });
+                        continue;
+                    }
+                    int a = locs.back(); locs.pop_back();
+                    int tmp = std::max(f.d, a) + 1;
+                    emit(VOP_POWI, f.d, a, tmp, ast[n.right].value, 0);
+                    locs.push_back(f.d);
+                    todo.pop_back();
+                    continue;
+                }
+
+                expr_arena::index first  = need[n.left] >= need[n.right] ? n.left : n.right;
+                expr_arena::index second = first == n.left ? n.right : n.left;
+                if (f.state == 0) {
+                    f.state      = 1;
+                    f.left_first = first == n.left;
+                    todo.push_back(frame{ first, f.d, 0, 0, true });
+                }
+                else if (f.state == 1) {
+                    f.state     = 2;
+                    f.first_loc = locs.back(); locs.pop_back();
+                    int d = f.first_loc == 0 ? f.d : f.d + 1;
+                    todo.push_back(frame{ second, d, 0, 0, true });
+                }
+                else {
+                    int second_loc = locs.back(); locs.pop_back();
+                    int a = f.left_first ? f.first_loc : second_loc;
+                    int b = f.left_first ? second_loc : f.first_loc;
+                    int d = f.d;
+                    emit(op_of(n.kind), d, a, b, 0, 0);
+                    todo.pop_back();
+                    locs.push_back(d);
+                }
+            }
+            result = locs.back();
+        }
+
+        static int op_of(int kind) {
+            switch (kind) {
+                case EXPR_ADD: return VOP_ADD;
+                case EXPR_SUB: return VOP_SUB;
+                case EXPR_MUL: return VOP_MUL;
+                default:       return VOP_DIV;
+            }
+        }
+
+        void emit(int op, int dst, int a, int b, int n, double c) {
+            n_registers = std::max(n_registers, std::max(dst, std::max(a, b)) + 1);
+            code.push_back(expr_vinstr{ uint8_t(op), uint16_t(dst), uint16_t(a), uint16_t(b), n, c });
+        }
+    private:
+        std::vector<expr_vinstr> code;
+        int                      n_registers;
+        int                      result;
+};
+
+#endif
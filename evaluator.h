@@ -17,17 +17,20 @@ class evaluator {
         evaluator() { stack.resize(1024*8); rule_functions.resize(128); }
         ~evaluator() {}
 
-        void initial_step(context_type* context, marpa::value& v) {
+        template <class V>
+        void initial_step(context_type* context, V& v) {
             context->initial();
         }
 
-        void token_step(context_type* context, marpa::value& v) {
+        template <class V>
+        void token_step(context_type* context, V& v) {
             //stack.resize(std::max((std::vector<int>::size_type)v.result()+1, stack.size()));
             auto out = &stack[v.result()];
             *out = context->convert(v.token_value());
         }
 
-        void rule_step(context_type* context, marpa::value& v) {
+        template <class V>
+        void rule_step(context_type* context, V& v) {
             marpa::grammar::rule_id rule = v.rule();
             //stack.resize(std::max((std::vector<int>::size_type)v.result()+1, stack.size()));
 
@@ -40,12 +43,14 @@ class evaluator {
         }
 
         // not sure...
-        void nulling_symbol_step(context_type* context, marpa::value& v) {
+        template <class V>
+        void nulling_symbol_step(context_type* context, V& v) {
             auto out = &stack[v.result()];
             *out = context->convert(v.token_value());
         }
 
-        void inactive_step(context_type* context, marpa::value& v) {
+        template <class V>
+        void inactive_step(context_type* context, V& v) {
             context->inactive();
         }
 
@@ -60,8 +65,10 @@ class evaluator {
 
 };
 
-template <typename E, typename C>
-void evaluate_steps(E* e, marpa::value& v, C* ctxt) {
+// V is a marpa::value, or anything that steps like one, such as a
+// value_tape::cursor.
+template <typename E, typename V, typename C>
+void evaluate_steps(E* e, V& v, C* ctxt) {
     for (;;) {
         marpa::value::step_type type = v.step();
 
@@ -0,0 +1,250 @@
+#ifndef FOREST_H
+#define FOREST_H
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include "marpa-cpp/marpa.hpp"
+#include "read_file.h"
+
+// Parse forests on disk, so other processes can analyse or evaluate all
+// parses of an input later, without lexing and recognizing it again:
+//
+//   header | rules[n_rules] | or_nodes[n_or] | and_nodes[n_and]
+//
+// The nodes are libmarpa's bocage. An or-node is an Earley item: an
+// internal rule with a dot position, from its origin to its Earley set.
+// Its and-nodes, first_and .. first_and + n_and - 1, are the alternative
+// ways to derive it. Each is a predecessor or-node, the rule up to the
+// symbol before the dot, plus a cause: an or-node for a nonterminal, or a
+// token with its value. The internal rules are libmarpa's rewrite of the
+// grammar; rules[] maps them back to the rule ids the generated code uses.
+//
+// All numbers are in host byte order. A file that does not check out
+// (other version, truncated, an index out of range) is rejected.
+
+const char     forest_magic[8] = { 'M', 'A', 'R', 'P', 'A', 'F', 'S', 'T' };
+const uint32_t forest_version  = 1;
+
+struct forest_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t n_rules;
+    uint32_t n_or;
+    uint32_t n_and;
+    int32_t  top;         // the or-node of the whole parse
+};
+
+struct forest_rule {
+    int32_t source;       // the grammar's rule, -1 for none
+    int32_t length;
+};
+
+struct forest_or_node {
+    int32_t rule;
+    int32_t position;     // of the dot
+    int32_t origin;       // Earley sets
+    int32_t set;
+    int32_t first_and;
+    int32_t n_and;
+};
+
+struct forest_and_node {
+    int32_t predecessor;  // or-node, -1 for none
+    int32_t cause;        // or-node, -1 for a token
+    int32_t symbol;       // of the cause
+    int32_t value;        // of the token
+};
+
+struct forest_view {
+    const forest_rule*     rules;
+    const forest_or_node*  or_nodes;
+    const forest_and_node* and_nodes;
+    uint32_t               n_rules;
+    uint32_t               n_or;
+    uint32_t               n_and;
+    int32_t                top;
+};
+
+// Every index in range and every or-node with an and-node.
+inline bool forest_verify(const forest_view& f) {
+    if (f.top < 0 || uint32_t(f.top) >= f.n_or) return false;
+    for (uint32_t i = 0; i < f.n_or; ++i) {
+        const forest_or_node& o = f.or_nodes[i];
+        if (o.rule < 0 || uint32_t(o.rule) >= f.n_rules || o.first_and < 0 || o.n_and <= 0
+                || uint64_t(o.first_and) + o.n_and > f.n_and) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < f.n_and; ++i) {
+        const forest_and_node& a = f.and_nodes[i];
+        if (a.predecessor < -1 || a.predecessor >= int64_t(f.n_or) || a.cause < -1 || a.cause >= int64_t(f.n_or)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A bocage copied out of libmarpa, which also needs the grammar to map
+// the internal rules and symbols back.
+class forest {
+    public:
+        bool build(marpa::grammar& g, marpa::bocage& b) {
+            Marpa_Grammar gh = g.internal_handle();
+            Marpa_Bocage  bh = b.internal_handle();
+            rules.clear();
+            or_nodes.clear();
+            and_nodes.clear();
+
+            top = _marpa_b_top_or_node(bh);
+            if (top < 0) return false;
+
+            int n_irl = _marpa_g_irl_count(gh);
+            for (int i = 0; i < n_irl; ++i) {
+                rules.push_back(forest_rule{ _marpa_g_source_xrl(gh, i), _marpa_g_irl_length(gh, i) });
+            }
+
+            // or-node ids are dense; the first one past the end gives -1
+            for (int id = 0; _marpa_b_or_node_set(bh, id) >= 0; ++id) {
+                int first = _marpa_b_or_node_first_and(bh, id);
+                int last  = _marpa_b_or_node_last_and(bh, id);
+                or_nodes.push_back(forest_or_node{
+                    _marpa_b_or_node_irl(bh, id), _marpa_b_or_node_position(bh, id),
+                    _marpa_b_or_node_origin(bh, id), _marpa_b_or_node_set(bh, id), first, last - first + 1 });
+            }
+
+            int n_and = _marpa_b_and_node_count(bh);
+            for (int id = 0; id < n_and; ++id) {
+                int value = 0;
+                int token = _marpa_b_and_node_token(bh, id, &value);
+                int cause = _marpa_b_and_node_cause(bh, id);
+                int isy   = token >= 0 ? token : _marpa_b_and_node_symbol(bh, id);
+                and_nodes.push_back(forest_and_node{
+                    _marpa_b_and_node_predecessor(bh, id), token >= 0 ? -1 : cause,
+                    isy >= 0 ? _marpa_g_source_xsy(gh, isy) : -1, token >= 0 ? value : 0 });
+            }
+            return forest_verify(view());
+        }
+
+        forest_view view() const {
+            return forest_view{ rules.data(), or_nodes.data(), and_nodes.data(),
+                                uint32_t(rules.size()), uint32_t(or_nodes.size()), uint32_t(and_nodes.size()), top };
+        }
+
+        bool write(const std::string& filename) const {
+            forest_header h;
+            memset(&h, 0, sizeof h);
+            memcpy(h.magic, forest_magic, sizeof h.magic);
+            h.version     = forest_version;
+            h.header_size = sizeof h;
+            h.n_rules     = rules.size();
+            h.n_or        = or_nodes.size();
+            h.n_and       = and_nodes.size();
+            h.top         = top;
+
+            // Write a temporary file and rename it, so readers never see half a forest.
+            std::string tmp = filename + ".tmp";
+            FILE* f = fopen(tmp.c_str(), "wb");
+            if (!f) return false;
+            bool ok = fwrite(&h, sizeof h, 1, f) == 1
+                && fwrite(rules.data(), sizeof(forest_rule), rules.size(), f) == rules.size()
+                && fwrite(or_nodes.data(), sizeof(forest_or_node), or_nodes.size(), f) == or_nodes.size()
+                && fwrite(and_nodes.data(), sizeof(forest_and_node), and_nodes.size(), f) == and_nodes.size();
+            ok = fclose(f) == 0 && ok;
+            if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+                remove(tmp.c_str());
+                return false;
+            }
+            return true;
+        }
+    private:
+        std::vector<forest_rule>     rules;
+        std::vector<forest_or_node>  or_nodes;
+        std::vector<forest_and_node> and_nodes;
+        int32_t                      top;
+};
+
+// A mapped forest file; view() is only valid when ok().
+class forest_file {
+    public:
+        explicit forest_file(const std::string& filename) : file(filename), valid(false) {
+            memset(&f, 0, sizeof f);
+            if (!file.ok() || file.size() < sizeof(forest_header)) return;
+
+            forest_header h;
+            memcpy(&h, file.data(), sizeof h);
+            if (memcmp(h.magic, forest_magic, sizeof h.magic) != 0
+                    || h.version != forest_version
+                    || h.header_size != sizeof h) {
+                return;
+            }
+            uint64_t rules_end = sizeof h + uint64_t(h.n_rules) * sizeof(forest_rule);
+            uint64_t or_end    = rules_end + uint64_t(h.n_or) * sizeof(forest_or_node);
+            uint64_t and_end   = or_end + uint64_t(h.n_and) * sizeof(forest_and_node);
+            if (and_end != file.size()) return;
+
+            f.rules     = (const forest_rule*)(file.data() + sizeof h);
+            f.or_nodes  = (const forest_or_node*)(file.data() + rules_end);
+            f.and_nodes = (const forest_and_node*)(file.data() + or_end);
+            f.n_rules   = h.n_rules;
+            f.n_or      = h.n_or;
+            f.n_and     = h.n_and;
+            f.top       = h.top;
+            valid       = forest_verify(f);
+        }
+
+        bool ok() const { return valid; }
+
+        const forest_view& view() const { return f; }
+    private:
+        mapped_file file;
+        bool        valid;
+        forest_view f;
+};
+
+// The number of parse trees below the top or-node, infinity when the
+// forest has a cycle. Iterative, forests of long inputs are deep.
+inline double forest_tree_count(const forest_view& f) {
+    const double unknown = -1, busy = -2;
+    std::vector<double> count(f.n_or, unknown);
+    std::vector<int32_t> todo(1, f.top);
+
+    while (!todo.empty()) {
+        int32_t o = todo.back();
+        if (count[o] >= 0) {
+            todo.pop_back();
+            continue;
+        }
+
+        // children first, then sum the products of their counts
+        bool ready = true;
+        const forest_or_node& node = f.or_nodes[o];
+        for (int32_t i = node.first_and; i < node.first_and + node.n_and; ++i) {
+            for (int32_t child : { f.and_nodes[i].predecessor, f.and_nodes[i].cause }) {
+                if (child < 0 || count[child] >= 0) continue;
+                if (count[child] == busy || child == o) return std::numeric_limits<double>::infinity();
+                todo.push_back(child);
+                ready = false;
+            }
+        }
+        if (!ready) {
+            count[o] = busy;
+            continue;
+        }
+
+        double n = 0;
+        for (int32_t i = node.first_and; i < node.first_and + node.n_and; ++i) {
+            const forest_and_node& a = f.and_nodes[i];
+            n += (a.predecessor < 0 ? 1 : count[a.predecessor]) * (a.cause < 0 ? 1 : count[a.cause]);
+        }
+        count[o] = n;
+        todo.pop_back();
+    }
+    return count[f.top];
+}
+
+#endif
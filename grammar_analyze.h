@@ -0,0 +1,297 @@
+#ifndef GRAMMAR_ANALYZE_H
+#define GRAMMAR_ANALYZE_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include "marpa-cpp/marpa.hpp"
+#include "error.h"
+
+// Performance lint for a DSL grammar, run by `testmarpa --analyze`.
+//
+// The grammar is precomputed by libmarpa, which reports errors, cycles
+// (loop rules) and rules that can never take part in a parse. Then a few
+// static checks look for shapes that parse correctly but slowly:
+//
+//   ambiguous     A ::= A x A recurses at both ends, so every chain of
+//                 them has many parses; two such rules for one A have no
+//                 precedence between them; two alternatives of A that
+//                 reach the same symbol through unit rules
+//   nullable      rules with several nullable symbols, which libmarpa
+//                 rewrites into up to 2^n rules, and sequences of a
+//                 nullable item
+//   no Leo        right recursion where another item expecting the same
+//                 symbol is predicted into the same Earley set, so Leo's
+//                 memoization does not apply and the recursion costs
+//                 quadratic time; a heuristic, it only looks at predictions
+//
+// Symbols and rules use 0-based symbol numbers.
+
+struct analyzed_rule {
+    int              lhs;
+    std::vector<int> rhs;         // the item for a sequence
+    bool             sequence;
+    int              min;         // sequences: 0 for *, 1 for +
+    int              separator;   // sequences: -1 for none
+    int              flags;       // sequences: for new_sequence
+};
+
+class grammar_analysis {
+    public:
+        grammar_analysis(const std::vector<std::string>& names, const std::vector<analyzed_rule>& rules,
+                         int start, const std::string& filename, std::ostream& out)
+            : names(names), rules(rules), start(start), filename(filename), out(out), findings(0) {}
+
+        // Writes every finding and returns how many there were.
+        int run() {
+            find_nullable();
+            check_libmarpa();
+            check_ambiguity();
+            check_nullable();
+            check_leo();
+            return findings;
+        }
+
+        std::string rule_text(const analyzed_rule& r) const {
+            std::string s = names[r.lhs] + " ::=";
+            if (r.sequence) {
+                s += " " + names[r.rhs[0]] + (r.min == 0 ? "*" : "+");
+                if (r.separator != -1) s += " " + names[r.separator];
+                if (r.flags & MARPA_PROPER_SEPARATION) s += " %proper";
+                if (r.flags & MARPA_KEEP_SEPARATION) s += " %keep";
+            }
+            else if (r.rhs.empty()) {
+                s += " null";
+            }
+            for (size_t i = 0; !r.sequence && i < r.rhs.size(); ++i) {
+                s += " " + names[r.rhs[i]];
+            }
+            return s;
+        }
+    private:
+        void report(const char* kind, const analyzed_rule& r, const std::string& detail) {
+            out << filename << ": " << kind << ": " << rule_text(r) << "\n"
+                << "    " << detail << "\n";
+            ++findings;
+        }
+
+        void find_nullable() {
+            nullable.assign(names.size(), false);
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const analyzed_rule& r : rules) {
+                    if (nullable[r.lhs]) continue;
+                    bool all = r.sequence ? r.min == 0 || nullable[r.rhs[0]] : true;
+                    for (size_t i = 0; !r.sequence && i < r.rhs.size(); ++i) {
+                        all = all && nullable[r.rhs[i]];
+                    }
+                    if (all) nullable[r.lhs] = changed = true;
+                }
+            }
+        }
+
+        void check_libmarpa() {
+            marpa::grammar g;
+            std::vector<marpa::grammar::symbol_id> ids;
+            for (size_t i = 0; i < names.size(); ++i) {
+                ids.push_back(g.new_symbol());
+            }
+
+            std::vector<marpa::grammar::rule_id> rule_ids;
+            for (const analyzed_rule& r : rules) {
+                marpa::grammar::rule_id id;
+                if (r.sequence) {
+                    id = g.new_sequence(ids[r.lhs], ids[r.rhs[0]], r.separator == -1 ? -1 : ids[r.separator], r.min, r.flags);
+                }
+                else {
+                    std::vector<marpa::grammar::symbol_id> rhs;
+                    for (int s : r.rhs) rhs.push_back(ids[s]);
+                    id = g.new_rule(ids[r.lhs], rhs.data(), rhs.size());
+                }
+                if (id < 0) {
+                    report("error", r, std::string("libmarpa rejects the rule: ") + marpa_errors[g.error()]);
+                }
+                rule_ids.push_back(id);
+            }
+
+            g.start_symbol(ids[start]);
+            if (g.precompute() < 0) {
+                out << filename << ": error: precompute failed: " << marpa_errors[g.error()] << "\n";
+                ++findings;
+                return;
+            }
+
+            Marpa_Grammar h = g.internal_handle();
+            for (size_t i = 0; i < rules.size(); ++i) {
+                if (rule_ids[i] < 0) continue;
+                if (marpa_g_rule_is_loop(h, rule_ids[i]) > 0) {
+                    report("cycle", rules[i], "the rule can derive its own left hand side alone, "
+                                              "so some inputs have infinitely many parses");
+                }
+                if (marpa_g_rule_is_accessible(h, rule_ids[i]) == 0) {
+                    report("unused", rules[i], "not reachable from the start symbol " + names[start]);
+                }
+                else if (marpa_g_rule_is_productive(h, rule_ids[i]) == 0) {
+                    report("unused", rules[i], "can never derive any input");
+                }
+            }
+        }
+
+        bool recurses_both_ends(const analyzed_rule& r) const {
+            return !r.sequence && r.rhs.size() >= 2 && r.rhs.front() == r.lhs && r.rhs.back() == r.lhs;
+        }
+
+        // Symbols reachable from s through rules with one symbol.
+        std::vector<bool> unit_closure(int s) const {
+            std::vector<bool> seen(names.size(), false);
+            std::vector<int> todo(1, s);
+            seen[s] = true;
+            while (!todo.empty()) {
+                int a = todo.back();
+                todo.pop_back();
+                for (const analyzed_rule& r : rules) {
+                    if (r.lhs == a && !r.sequence && r.rhs.size() == 1 && !seen[r.rhs[0]]) {
+                        seen[r.rhs[0]] = true;
+                        todo.push_back(r.rhs[0]);
+                    }
+                }
+            }
+            return seen;
+        }
+
+        void check_ambiguity() {
+            for (size_t i = 0; i < rules.size(); ++i) {
+                const analyzed_rule& a = rules[i];
+                if (!recurses_both_ends(a)) continue;
+                report("ambiguous", a, "recurses at both ends, so " + names[a.lhs] + " chains of n operators "
+                                       "have Catalan(n) parses; split it into levels with left or right recursion");
+                for (size_t j = i + 1; j < rules.size(); ++j) {
+                    if (rules[j].lhs == a.lhs && recurses_both_ends(rules[j])) {
+                        report("ambiguous", a, "and " + rule_text(rules[j]) + " have no precedence between them");
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < rules.size(); ++i) {
+                const analyzed_rule& a = rules[i];
+                if (a.sequence || a.rhs.size() != 1) continue;
+                std::vector<bool> reach = unit_closure(a.rhs[0]);
+                for (size_t j = i + 1; j < rules.size(); ++j) {
+                    const analyzed_rule& b = rules[j];
+                    if (b.lhs != a.lhs || b.sequence || b.rhs.size() != 1) continue;
+                    std::vector<bool> other = unit_closure(b.rhs[0]);
+                    for (size_t s = 0; s < names.size(); ++s) {
+                        if (reach[s] && other[s]) {
+                            report("ambiguous", a, "and " + rule_text(b) + " both derive " + names[s]);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        void check_nullable() {
+            for (const analyzed_rule& r : rules) {
+                if (r.sequence) {
+                    if (nullable[r.rhs[0]]) {
+                        report("nullable", r, "a sequence of the nullable " + names[r.rhs[0]]
+                                              + " can null any number of items");
+                    }
+                    continue;
+                }
+                int n = 0;
+                for (int s : r.rhs) n += nullable[s];
+                if (n >= 2) {
+                    report("nullable", r, std::to_string(n) + " nullable symbols, rewritten into up to "
+                                          + std::to_string(1 << std::min(n, 30)) + " rules");
+                }
+            }
+        }
+
+        // Symbols that can start a derivation of s, s included; a
+        // sequence starts with its item.
+        std::vector<bool> left_corners(int s) const {
+            std::vector<bool> seen(names.size(), false);
+            std::vector<int> todo(1, s);
+            seen[s] = true;
+            while (!todo.empty()) {
+                int a = todo.back();
+                todo.pop_back();
+                for (const analyzed_rule& r : rules) {
+                    if (r.lhs != a) continue;
+                    for (size_t i = 0; i < r.rhs.size(); ++i) {
+                        if (!seen[r.rhs[i]]) {
+                            seen[r.rhs[i]] = true;
+                            todo.push_back(r.rhs[i]);
+                        }
+                        if (!nullable[r.rhs[i]]) break;
+                    }
+                }
+            }
+            return seen;
+        }
+
+        // Symbols that can end a derivation of s, s included.
+        std::vector<bool> right_corners(int s) const {
+            std::vector<bool> seen(names.size(), false);
+            std::vector<int> todo(1, s);
+            seen[s] = true;
+            while (!todo.empty()) {
+                int a = todo.back();
+                todo.pop_back();
+                for (const analyzed_rule& r : rules) {
+                    if (r.lhs != a || r.sequence) continue;
+                    for (size_t i = r.rhs.size(); i-- > 0; ) {
+                        if (!seen[r.rhs[i]]) {
+                            seen[r.rhs[i]] = true;
+                            todo.push_back(r.rhs[i]);
+                        }
+                        if (!nullable[r.rhs[i]]) break;
+                    }
+                }
+            }
+            return seen;
+        }
+
+        void check_leo() {
+            for (const analyzed_rule& r : rules) {
+                if (r.sequence || r.rhs.size() < 2) continue;
+                // the penult: the last symbol that is not nullable
+                int p = r.rhs.size() - 1;
+                while (p > 0 && nullable[r.rhs[p]]) --p;
+                if (p == 0) continue;
+                int s = r.rhs[p];
+                if (!right_corners(s)[r.lhs]) continue;
+
+                // with the dot before s, predicting s adds items for the
+                // rules of its left corners; one of those expecting s
+                // first makes the Leo item not unique
+                std::vector<bool> predicted = left_corners(s);
+                for (const analyzed_rule& q : rules) {
+                    if (!predicted[q.lhs]) continue;
+                    bool expects = false;
+                    for (size_t i = 0; i < q.rhs.size(); ++i) {
+                        if (q.rhs[i] == s) expects = true;
+                        if (expects || !nullable[q.rhs[i]]) break;
+                    }
+                    if (expects) {
+                        report("no Leo", r, "right recursion through " + names[s] + ", but " + rule_text(q)
+                                            + " also expects " + names[s] + " in the same Earley set; "
+                                            + "this recursion takes quadratic time");
+                        break;
+                    }
+                }
+            }
+        }
+    private:
+        const std::vector<std::string>&   names;
+        const std::vector<analyzed_rule>& rules;
+        int                               start;
+        std::string                       filename;
+        std::ostream&                     out;
+        int                               findings;
+        std::vector<bool>                 nullable;
+};
+
+#endif
@@ -0,0 +1,504 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include "grammar_loader.h"
+#include "meta_rules.h"
+#include "error.h"
+#include "lexer.h"
+#include "token_log.h"
+
+namespace {
+
+// What the rules of marpa.txt do, by the rule as it is written there.
+// Every rule of the rules section needs one, except those that pass $0
+// on; a rule that is missing either way fails every load.
+enum meta_action {
+    M_NONE, M_RULE, M_TOKEN_RULE, M_ASSOC_RULE, M_UNVALUED_RULE,
+    M_RHS_NAMES, M_RHS_SEQUENCE, M_RHS_NULL, M_NAMES, M_MIN_STAR, M_MIN_PLUS,
+    M_SEPARATION, M_PROPER, M_KEEP, M_DISCARD, M_LEFT, M_RIGHT, M_NONASSOC,
+    M_COPY
+};
+
+const struct {
+    const char* rule;
+    meta_action action;
+} meta_actions[] = {
+    { "rules ::= rule+",                  M_NONE },
+    { "rule ::= lhs BNF rhs",             M_RULE },
+    { "rule ::= lhs BNF rhs code",        M_RULE },
+    { "rule ::= lhs STROP string",        M_TOKEN_RULE },
+    { "rule ::= assoc names",             M_ASSOC_RULE },
+    { "rule ::= UNVALUED names",          M_UNVALUED_RULE },
+    { "rhs ::= names",                    M_RHS_NAMES },
+    { "rhs ::= name min",                 M_RHS_SEQUENCE },
+    { "rhs ::= name min name",            M_RHS_SEQUENCE },
+    { "rhs ::= name min name separation", M_RHS_SEQUENCE },
+    { "rhs ::= NULL",                     M_RHS_NULL },
+    { "names ::= name+",                  M_NAMES },
+    { "min ::= STAR",                     M_MIN_STAR },
+    { "min ::= PLUS",                     M_MIN_PLUS },
+    { "separation ::= sepflag+",          M_SEPARATION },
+    { "sepflag ::= PROPER",               M_PROPER },
+    { "sepflag ::= KEEP",                 M_KEEP },
+    { "sepflag ::= DISCARD",              M_DISCARD },
+    { "assoc ::= LEFT",                   M_LEFT },
+    { "assoc ::= RIGHT",                  M_RIGHT },
+    { "assoc ::= NONASSOC",               M_NONASSOC },
+};
+
+// Words of the rules section; a code block or a string is one word.
+std::vector<std::string> meta_words(const std::string& text) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < text.size()) {
+        size_t end;
+        if (isspace((unsigned char)text[i])) {
+            ++i;
+            continue;
+        }
+        if (text[i] == '#') {
+            end = text.find('\n', i);
+            i = end == std::string::npos ? text.size() : end;
+            continue;
+        }
+        if (text.compare(i, 2, "{{") == 0) {
+            end = text.find("}}", i + 2);
+            end = end == std::string::npos ? text.size() : end + 2;
+        }
+        else if (text[i] == '"') {
+            end = text.find('"', i + 1);
+            end = end == std::string::npos ? text.size() : end + 1;
+        }
+        else {
+            end = i;
+            while (end < text.size() && !isspace((unsigned char)text[end])) ++end;
+        }
+        words.push_back(text.substr(i, end - i));
+        i = end;
+    }
+    return words;
+}
+
+// The grammar of the rules DSL, from the rules section of marpa.txt. That
+// section only has `lhs ::= names` and `lhs ::= item+` rules, with or
+// without code, and `token ~ "str"` rules, so reading it needs no parser.
+struct meta_grammar {
+    marpa::grammar                                                 g;
+    std::map<std::string, marpa::grammar::symbol_id>               symbols;
+    std::vector<std::pair<std::string, marpa::grammar::symbol_id>> literals;
+    std::vector<meta_action>                                       actions;  // by rule id
+    std::string                                                    error;
+
+    meta_grammar() {
+        std::vector<std::string> w = meta_words(meta_rules);
+        std::vector<bool> found(sizeof meta_actions / sizeof meta_actions[0], false);
+
+        auto is_rule_start = [&](size_t i) {
+            return i + 1 < w.size() && (w[i + 1] == "::=" || w[i + 1] == "~");
+        };
+
+        size_t i = 0;
+        while (i < w.size() && error.empty()) {
+            if (!is_rule_start(i)) {
+                error = "meta grammar: unexpected " + w[i];
+                break;
+            }
+            marpa::grammar::symbol_id lhs = symbol(w[i]);
+            if (w[i + 1] == "~") {
+                if (i + 2 >= w.size() || w[i + 2][0] != '"') {
+                    error = "meta grammar: " + w[i] + " ~ without a string";
+                    break;
+                }
+                literals.push_back(std::make_pair(w[i + 2].substr(1, w[i + 2].size() - 2), lhs));
+                i += 3;
+                continue;
+            }
+
+            std::string written = w[i] + " ::=";
+            std::vector<marpa::grammar::symbol_id> rhs;
+            int min = 3;
+            for (i += 2; i < w.size() && w[i].compare(0, 2, "{{") != 0 && !is_rule_start(i); ++i) {
+                written += " " + w[i];
+                char last = w[i][w[i].size() - 1];
+                if (w[i].size() > 1 && (last == '*' || last == '+')) {
+                    min = last == '*' ? 1 : 2;
+                    rhs.push_back(symbol(w[i].substr(0, w[i].size() - 1)));
+                }
+                else {
+                    rhs.push_back(symbol(w[i]));
+                }
+            }
+            std::string code;
+            if (i < w.size() && w[i].compare(0, 2, "{{") == 0) {
+                code = w[i].substr(2, w[i].size() - 4);
+                ++i;
+            }
+
+            marpa::grammar::rule_id id = min == 3
+                ? g.new_rule(lhs, rhs.data(), rhs.size())
+                : g.new_sequence(lhs, rhs[0], rhs.size() > 1 ? rhs[1] : -1, min - 1, 0);
+            if (id != marpa::grammar::rule_id(actions.size())) {
+                error = "meta grammar: " + written + " rejected";
+                break;
+            }
+
+            meta_action action = dsl_code_copies(code) && min == 3 && rhs.size() == 1 ? M_COPY : M_NONE;
+            bool known = action == M_COPY;
+            for (size_t k = 0; k < found.size(); ++k) {
+                if (written == meta_actions[k].rule) {
+                    action   = meta_actions[k].action;
+                    found[k] = known = true;
+                }
+            }
+            if (!known) {
+                error = "meta grammar: nothing does " + written;
+            }
+            actions.push_back(action);
+        }
+
+        for (size_t k = 0; k < found.size() && error.empty(); ++k) {
+            if (!found[k]) error = std::string("meta grammar: no rule ") + meta_actions[k].rule;
+        }
+        if (error.empty() && actions.empty()) {
+            error = "meta grammar: no rules";
+        }
+        if (error.empty()) {
+            g.start_symbol(0);
+            if (g.precompute() < 0) {
+                error = std::string("meta grammar: ") + marpa_errors[g.error()];
+            }
+        }
+    }
+
+    // The symbol of a name, made on first use.
+    marpa::grammar::symbol_id symbol(const std::string& name) {
+        auto it = symbols.find(name);
+        if (it == symbols.end()) {
+            it = symbols.insert(std::make_pair(name, g.new_symbol())).first;
+        }
+        return it->second;
+    }
+
+    template <typename T>
+    void create_lexer(T& lex) const {
+        for (const auto& t : literals) {
+            lex.add_literal(t.first.c_str(), t.second, 1);
+        }
+        lex.ident(symbols.at("name"));
+        lex.comment('#');
+    }
+
+    // The tokens of `~` rules have no value.
+    void set_valued(marpa::value& v) const {
+        for (const auto& s : symbols) {
+            bool literal = false;
+            for (const auto& t : literals) {
+                literal = literal || t.second == s.second;
+            }
+            v.symbol_is_valued(s.second, !literal);
+        }
+    }
+};
+
+std::string location(const std::string& text, int offset) {
+    token_log log(text.data(), text.data() + text.size());
+    source_location loc = log.location_of(offset);
+    return std::to_string(loc.line) + ":" + std::to_string(loc.column) + ": ";
+}
+
+std::string without_space(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (!isspace((unsigned char)c)) out += c;
+    }
+    return out;
+}
+
+bool is_identifier(const std::string& s) {
+    if (s.empty() || !(isalpha((unsigned char)s[0]) || s[0] == '_')) return false;
+    for (char c : s) {
+        if (!(isalnum((unsigned char)c) || c == '_')) return false;
+    }
+    return true;
+}
+
+}
+
+bool grammar_loader::load(const std::string& text, std::string& error) {
+    names.clear();
+    symbols.clear();
+    codes.assign(1, std::string());
+    code_offsets.assign(1, -1);
+    rules.clear();
+    precedence.clear();
+    unvalued.clear();
+    literals.clear();
+    rule_actions.clear();
+    valued.clear();
+    g.reset();
+
+    auto name_of    = [this](int s) -> const std::string& { return names[s]; };
+    auto add_symbol = [this](const std::string& name) {
+        if (symbols.count(name)) return -1;
+        symbols[name] = names.size();
+        names.push_back(name);
+        return int(names.size() - 1);
+    };
+
+    if (!read_rules(text, error) || !dsl_rewrite_precedence(rules, precedence, name_of, add_symbol, error)
+            || !build(text, error)) {
+        g.reset();
+        return false;
+    }
+    valued = dsl_valued_symbols(rules, names.size(), unvalued);
+    return true;
+}
+
+// Lexes like testmarpa does and evaluates the one parse of the rules into
+// the tables. Token values are table index + 1, libmarpa does not take 0.
+bool grammar_loader::read_rules(const std::string& text, std::string& error) {
+    meta_grammar meta;
+    if (!meta.error.empty()) {
+        error = meta.error;
+        return false;
+    }
+    const marpa::grammar::symbol_id name_symbol   = meta.symbols.at("name");
+    const marpa::grammar::symbol_id string_symbol = meta.symbols.at("string");
+    const marpa::grammar::symbol_id code_symbol   = meta.symbols.at("code");
+
+    const char* first = text.data();
+    const char* last  = text.data() + text.size();
+
+    // the rules section, or all of the text
+    const char* sep_pos = std::search(first, last, "%%", "%%" + 2);
+    const char* start   = first;
+    if (sep_pos != last) {
+        start   = sep_pos + 2;
+        sep_pos = std::search(start, last, "%%", "%%" + 2);
+        last    = sep_pos;
+    }
+
+    lexer_table<> lex;
+    meta.create_lexer(lex);
+
+    scanner<lexer_table<>> s(lex, first, last);
+    s.seek(start);
+
+    marpa::recognizer r(meta.g);
+    token_log log(first, text.data() + text.size());
+    std::vector<std::string> strings(1);
+
+    for (;;) {
+        lexeme token;
+        lexer_status status = s.next(token);
+        if (status == LEX_END) break;
+
+        const char* p = s.position();
+
+        if (status == LEX_TOKEN) {
+            if (token.symbol == name_symbol) {
+                std::string n(first + token.offset, token.length);
+                auto it = symbols.find(n);
+                if (it == symbols.end()) {
+                    it = symbols.insert(std::make_pair(n, int(names.size()))).first;
+                    names.push_back(n);
+                }
+                token.value = it->second + 1;
+            }
+        }
+        else if (*p == '"') {
+            const char* end = std::find(p + 1, last, '"');
+            if (end == last) {
+                error = location(text, p - first) + "string end not found";
+                return false;
+            }
+            strings.push_back(std::string(p + 1, end));
+            token = lexeme{ string_symbol, int(strings.size() - 1), int(p - first), int(end + 1 - p) };
+            s.seek(end + 1);
+        }
+        else if (last - p >= 2 && p[0] == '{' && p[1] == '{') {
+            const char* end = std::search(p + 2, last, "}}", "}}" + 2);
+            if (end == last) {
+                error = location(text, p - first) + "code block end not found";
+                return false;
+            }
+            codes.push_back(std::string(p + 2, end));
+            code_offsets.push_back(p - first);
+            token = lexeme{ code_symbol, int(codes.size() - 1), int(p - first), int(end + 2 - p) };
+            s.seek(end + 2);
+        }
+        else {
+            error = location(text, token.offset) + "unknown token";
+            return false;
+        }
+
+        if (log.read(r, token) != MARPA_ERR_NONE) {
+            error = location(text, token.offset) + "unexpected '" + std::string(first + token.offset, token.length) + "'";
+            return false;
+        }
+    }
+
+    marpa::bocage b{r, r.latest_earley_set()};
+    if (meta.g.error() != MARPA_ERR_NONE) {
+        error = location(text, last - first) + marpa_errors[meta.g.error()];
+        return false;
+    }
+
+    marpa::order o{b};
+    marpa::tree t{o};
+    if (t.next() < 0) {
+        error = location(text, last - first) + "no parse";
+        return false;
+    }
+
+    marpa::value v{t};
+    meta.set_valued(v);
+
+    // a rule's right hand side, before it has a left hand side and code
+    std::vector<dsl_rule>         rhs_list(1, dsl_rule{ -1, std::vector<int>(), 3, -1, 0, 0, true });
+    std::vector<std::vector<int>> names_lists(1);
+    std::vector<int>              stack(128);
+
+    auto same = [](const dsl_rule& a, const dsl_rule& b) {
+        return a.lhs == b.lhs && a.rhs == b.rhs && a.min == b.min && a.sep == b.sep && a.flags == b.flags
+            && a.code == b.code;
+    };
+
+    for (;;) {
+        marpa::value::step_type type = v.step();
+        if (type == MARPA_STEP_INACTIVE) break;
+        if (type == MARPA_STEP_TOKEN || type == MARPA_STEP_NULLING_SYMBOL) {
+            if (size_t(v.result()) >= stack.size()) stack.resize(2 * v.result() + 1);
+            stack[v.result()] = v.token_value();
+            continue;
+        }
+        if (type != MARPA_STEP_RULE) continue;
+
+        if (size_t(v.arg_n()) >= stack.size()) stack.resize(v.arg_n() + 1);
+        int* a  = &stack[v.arg_0()];
+        int  n  = v.arg_n() - v.arg_0() + 1;
+        int& rv = stack[v.result()];
+
+        switch (meta.actions[v.rule()]) {
+            case M_RULE: {
+                dsl_rule rule = rhs_list[a[2]];
+                rule.lhs    = a[0] - 1;
+                rule.code   = n == 4 ? a[3] : 0;
+                rule.copies = dsl_code_copies(codes[rule.code]);
+                auto is_rule = [&](const dsl_rule& other) { return same(rule, other); };
+                if (std::find_if(rules.begin(), rules.end(), is_rule) == rules.end()) {
+                    rules.push_back(rule);
+                }
+                break;
+            }
+            case M_TOKEN_RULE: {
+                std::pair<std::string, int> literal(strings[a[2]], a[0] - 1);
+                if (std::find(literals.begin(), literals.end(), literal) == literals.end()) {
+                    literals.push_back(literal);
+                }
+                break;
+            }
+            case M_ASSOC_RULE:
+                precedence.push_back(dsl_precedence{ a[0], names_lists[a[1]] });
+                break;
+            case M_UNVALUED_RULE:
+                for (int s : names_lists[a[1]]) {
+                    unvalued.push_back(s);
+                }
+                break;
+            case M_RHS_NAMES:
+                rhs_list.push_back(dsl_rule{ -1, names_lists[a[0]], 3, -1, 0, 0, true });
+                rv = rhs_list.size() - 1;
+                break;
+            case M_RHS_SEQUENCE:
+                rhs_list.push_back(dsl_rule{ -1, std::vector<int>{ a[0] - 1 }, a[1], n >= 3 ? a[2] - 1 : -1,
+                                             n == 4 ? a[3] : 0, 0, true });
+                rv = rhs_list.size() - 1;
+                break;
+            case M_RHS_NULL:
+                rv = 0;
+                break;
+            case M_NAMES: {
+                std::vector<int> list;
+                for (int i = 0; i < n; ++i) {
+                    list.push_back(a[i] - 1);
+                }
+                names_lists.push_back(list);
+                rv = names_lists.size() - 1;
+                break;
+            }
+            case M_MIN_STAR: rv = 1; break;
+            case M_MIN_PLUS: rv = 2; break;
+            case M_SEPARATION: {
+                int flags = 0;
+                for (int i = 0; i < n; ++i) {
+                    flags |= a[i];
+                }
+                rv = flags;
+                break;
+            }
+            case M_PROPER:   rv = MARPA_PROPER_SEPARATION; break;
+            case M_KEEP:     rv = MARPA_KEEP_SEPARATION; break;
+            case M_DISCARD:  rv = 0; break;
+            case M_LEFT:     rv = ASSOC_LEFT; break;
+            case M_RIGHT:    rv = ASSOC_RIGHT; break;
+            case M_NONASSOC: rv = ASSOC_NONASSOC; break;
+            case M_NONE:
+            case M_COPY:
+                break;
+        }
+    }
+
+    if (rules.empty()) {
+        error = "no rules";
+        return false;
+    }
+    return true;
+}
+
+// Creates the symbols in name order, so a name's index is its symbol id,
+// and the rules in order, so the rule ids index rule_actions.
+bool grammar_loader::build(const std::string& text, std::string& error) {
+    g.reset(new marpa::grammar);
+    for (size_t i = 0; i < names.size(); ++i) {
+        g->new_symbol();
+    }
+
+    for (const dsl_rule& rule : rules) {
+        marpa::grammar::rule_id id;
+        if (rule.min == 3) {
+            std::vector<marpa::grammar::symbol_id> rhs(rule.rhs);
+            id = g->new_rule(rule.lhs, rhs.data(), rhs.size());
+        }
+        else {
+            id = g->new_sequence(rule.lhs, rule.rhs[0], rule.sep, rule.min - 1, rule.flags);
+        }
+        if (id != marpa::grammar::rule_id(rule_actions.size())) {
+            error = "rule of " + names[rule.lhs] + " rejected: " + marpa_errors[g->error()];
+            return false;
+        }
+
+        std::string code = without_space(codes[rule.code]);
+        if (rule.copies) {
+            rule_actions.push_back(action());
+        }
+        else if (is_identifier(code) && actions.count(code)) {
+            rule_actions.push_back(actions[code]);
+        }
+        else {
+            error = location(text, code_offsets[rule.code])
+                + (is_identifier(code) ? "no action bound to " + code
+                                       : std::string("C++ actions can not run in a loaded grammar, bind a named action"));
+            return false;
+        }
+    }
+
+    g->start_symbol(0);
+    if (g->precompute() < 0) {
+        error = std::string("precompute() failed: ") + marpa_errors[g->error()];
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+#ifndef GRAMMAR_LOADER_H
+#define GRAMMAR_LOADER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include "marpa-cpp/marpa.hpp"
+#include "grammar_rewrite.h"
+
+// Reads a grammar in the rules DSL at runtime and builds a precomputed
+// marpa::grammar from it, without generating and compiling C++:
+//
+//   grammar_loader loader;
+//   loader.bind("add", [](const int* a, const int*) { return a[0] + a[2]; });
+//   std::string error;
+//   if (!loader.load(text, error)) ...
+//
+//   lexer_table<> lex;
+//   loader.create_lexer(lex);
+//   lex.number(loader.symbol("number"));
+//   marpa::recognizer r(loader.grammar());
+//   ... read tokens, bocage, order, tree t; t.next() ...
+//   marpa::value v{t};
+//   loader.set_valued(v);
+//   int result = loader.evaluate(v, stack);
+//
+// The text is the rules section of a DSL file; a whole file with its
+// pre-block and post-block between `%%` lines works too, the blocks are
+// ignored. Precedence and %unvalued declarations work as they do in the
+// generator. An action is the name of a function given to bind() before
+// load(), `term ::= term add term {{ add }}`. It gets the values of the
+// rule's symbols, $0 up to $N, and returns $$. A rule without an action,
+// or with `{{ $$ = $0; }}`, passes $0 on. Other C++ actions can not run
+// here, load() rejects them.
+//
+// The DSL itself is parsed with a grammar built from the rules section of
+// marpa.txt (meta_rules.h, made by the Makefile), and the rewrites are
+// grammar_rewrite.h's, so the loader reads what the generator reads.
+class grammar_loader {
+    public:
+        typedef std::function<int(const int* first, const int* last)> action;
+    public:
+        grammar_loader() {}
+
+        void bind(const std::string& name, action f) { actions[name] = f; }
+
+        // On failure `error` gets "line:column: message" and the loader
+        // has no grammar.
+        bool load(const std::string& text, std::string& error);
+
+        bool ok() const { return g.get() != 0; }
+        marpa::grammar& grammar() { return *g; }
+
+        // The symbol of a name, -1 if the grammar does not have it.
+        marpa::grammar::symbol_id symbol(const std::string& name) const {
+            auto it = symbols.find(name);
+            return it == symbols.end() ? -1 : it->second;
+        }
+
+        const std::string& symbol_name(marpa::grammar::symbol_id s) const { return names[s]; }
+        size_t symbol_count() const { return names.size(); }
+
+        // The `token ~ "str"` rules, as create_lexer() in generated code.
+        // The strings belong to the loader, so it has to outlive the table.
+        template <typename T>
+        void create_lexer(T& lex) const {
+            for (const auto& t : literals) {
+                lex.add_literal(t.first.c_str(), t.second, 1);
+            }
+        }
+
+        // Every symbol once, libmarpa locks the first setting.
+        void set_valued(marpa::value& v) const {
+            for (size_t s = 0; s < names.size(); ++s) {
+                v.symbol_is_valued(s, valued[s]);
+            }
+        }
+
+        // Steps v to the end and returns the value of the parse. v is a
+        // marpa::value or a value_tape::cursor.
+        template <typename V>
+        int evaluate(V& v, std::vector<int>& stack) const {
+            stack.resize(128);
+            for (;;) {
+                marpa::value::step_type type = v.step();
+                switch (type) {
+                    case MARPA_STEP_TOKEN:
+                    case MARPA_STEP_NULLING_SYMBOL:
+                        if (size_t(v.result()) >= stack.size()) stack.resize(2 * v.result() + 1);
+                        stack[v.result()] = v.token_value();
+                        break;
+                    case MARPA_STEP_RULE: {
+                        const action& f = rule_actions[v.rule()];
+                        if (f) {
+                            if (size_t(v.arg_n()) >= stack.size()) stack.resize(v.arg_n() + 1);
+                            stack[v.result()] = f(&stack[v.arg_0()], &stack[v.arg_n()] + 1);
+                        }
+                        break;
+                    }
+                    case MARPA_STEP_INACTIVE:
+                        return stack[0];
+                }
+            }
+        }
+    private:
+        bool read_rules(const std::string& text, std::string& error);
+        bool build(const std::string& text, std::string& error);
+    private:
+        std::map<std::string, action>   actions;
+
+        // read from the text, names are 0-based like the symbols
+        std::vector<std::string>        names;
+        std::map<std::string, int>      symbols;
+        std::vector<std::string>        codes;      // 1-based, 0 is none
+        std::vector<int>                code_offsets;
+        std::vector<dsl_rule>           rules;
+        std::vector<dsl_precedence>     precedence;
+        std::vector<int>                unvalued;
+
+        std::vector<std::pair<std::string, marpa::grammar::symbol_id>> literals;
+
+        std::unique_ptr<marpa::grammar> g;
+        std::vector<action>             rule_actions;  // by rule id, empty passes $0 on
+        std::vector<bool>               valued;
+};
+
+#endif
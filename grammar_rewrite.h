@@ -0,0 +1,171 @@
+#ifndef GRAMMAR_REWRITE_H
+#define GRAMMAR_REWRITE_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cctype>
+
+// What the rules DSL does to the rules it reads before they become a
+// grammar, shared by the generator (marpa.txt) and grammar_loader, so a
+// text makes the same grammar either way. Symbols are the caller's
+// numbers, all below the n_symbols it passes.
+
+// %left, %right and %nonassoc; a declaration binds tighter than the
+// ones before it
+enum { ASSOC_LEFT = 1, ASSOC_RIGHT = 2, ASSOC_NONASSOC = 3 };
+
+struct dsl_rule {
+    int              lhs;
+    std::vector<int> rhs;     // the names, or the item of a sequence
+    int              min;     // 1 == *, 2 == +, 3 == names
+    int              sep;     // -1 for none
+    int              flags;   // MARPA_PROPER_SEPARATION, MARPA_KEEP_SEPARATION
+    int              code;    // the caller's, 0 for none
+    bool             copies;  // no action or `$$ = $0;`
+};
+
+struct dsl_precedence {
+    int              assoc;
+    std::vector<int> operators;
+};
+
+// An action that only passes $0 on, spaces aside.
+inline bool dsl_code_copies(const std::string& code) {
+    std::string s;
+    for (char c : code) {
+        if (!isspace((unsigned char)c)) s += c;
+    }
+    return s.empty() || s == "$$=$0;";
+}
+
+// Rewrites the binary operator rules `A ::= A op A`, where op is declared
+// with a precedence, into one symbol per precedence level of A, loosest
+// first, so every expression has exactly one parse:
+//
+//   A        ::= A op A_level1          %left
+//   A        ::= A_level1 op A          %right
+//   A        ::= A_level1 op A_level1   %nonassoc
+//   A        ::= A_level1
+//   A_level1 ::= ...                    the next level, and so on
+//
+// The other rules of A move to the last level. The actions stay the same,
+// the operands keep their positions; the added unit rules have no action.
+//
+// name_of(s) is the name of a symbol; add_symbol(name) makes the symbol
+// of a level and returns it, or -1 when the name is taken, which fails
+// the rewrite with `error`.
+template <class NameOf, class AddSymbol>
+bool dsl_rewrite_precedence(std::vector<dsl_rule>& rules, const std::vector<dsl_precedence>& precedence,
+                            NameOf name_of, AddSymbol add_symbol, std::string& error) {
+    if (precedence.empty()) return true;
+
+    std::map<int, int> level, assoc;
+    for (size_t i = 0; i < precedence.size(); ++i) {
+        for (int op : precedence[i].operators) {
+            level[op] = i + 1;
+            assoc[op] = precedence[i].assoc;
+        }
+    }
+
+    std::vector<int> lhs_order;
+    for (const dsl_rule& rule : rules) {
+        if (std::find(lhs_order.begin(), lhs_order.end(), rule.lhs) == lhs_order.end()) {
+            lhs_order.push_back(rule.lhs);
+        }
+    }
+
+    auto is_operator_rule = [&](const dsl_rule& rule) {
+        return rule.min == 3 && rule.rhs.size() == 3 && rule.rhs[0] == rule.lhs && rule.rhs[2] == rule.lhs
+            && level.count(rule.rhs[1]);
+    };
+
+    std::vector<dsl_rule> rewritten;
+    for (int lhs : lhs_order) {
+        std::vector<int> levels;
+        for (const dsl_rule& rule : rules) {
+            if (rule.lhs == lhs && is_operator_rule(rule)) {
+                levels.push_back(level[rule.rhs[1]]);
+            }
+        }
+        std::sort(levels.begin(), levels.end());
+        levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+        std::vector<int> symbol(1, lhs);
+        for (size_t k = 1; k <= levels.size(); ++k) {
+            std::string name = name_of(lhs) + "_level" + std::to_string(k);
+            int s = add_symbol(name);
+            if (s < 0) {
+                error = name + " is used by the precedence levels of " + name_of(lhs);
+                return false;
+            }
+            symbol.push_back(s);
+        }
+
+        for (size_t k = 0; k < levels.size(); ++k) {
+            for (const dsl_rule& rule : rules) {
+                if (rule.lhs != lhs || !is_operator_rule(rule)) continue;
+                int op = rule.rhs[1];
+                if (level[op] != levels[k]) continue;
+
+                int left  = assoc[op] == ASSOC_LEFT  ? symbol[k] : symbol[k + 1];
+                int right = assoc[op] == ASSOC_RIGHT ? symbol[k] : symbol[k + 1];
+                rewritten.push_back(dsl_rule{ symbol[k], std::vector<int>{ left, op, right }, 3, -1, 0, rule.code, rule.copies });
+            }
+            rewritten.push_back(dsl_rule{ symbol[k], std::vector<int>{ symbol[k + 1] }, 3, -1, 0, 0, true });
+        }
+
+        for (const dsl_rule& rule : rules) {
+            if (rule.lhs == lhs && !is_operator_rule(rule)) {
+                dsl_rule moved = rule;
+                moved.lhs = symbol.back();
+                rewritten.push_back(moved);
+            }
+        }
+    }
+    rules.swap(rewritten);
+    return true;
+}
+
+// The symbols with value steps. Not valued are the %unvalued symbols, and
+// pass-through symbols: every rule of the symbol has one symbol that is
+// not nullable and copies it. When libmarpa skips such a rule the value
+// of its symbol stays in place. libmarpa sets a rule valued or not
+// through its left hand side, so this works on symbols, not rules.
+inline std::vector<bool> dsl_valued_symbols(const std::vector<dsl_rule>& rules, size_t n_symbols,
+                                            const std::vector<int>& unvalued) {
+    std::vector<bool> valued(n_symbols, true);
+    for (int s : unvalued) {
+        valued[s] = false;
+    }
+
+    std::vector<bool> nullable(n_symbols, false);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const dsl_rule& rule : rules) {
+            if (nullable[rule.lhs]) continue;
+            bool all = rule.min == 1;
+            if (rule.min == 3) {
+                all = true;
+                for (int s : rule.rhs) {
+                    all = all && nullable[s];
+                }
+            }
+            if (all) nullable[rule.lhs] = changed = true;
+        }
+    }
+
+    std::vector<int> pass_through(n_symbols, -1);  // -1 unseen, 0 no, 1 yes
+    for (const dsl_rule& rule : rules) {
+        bool copies = rule.min == 3 && rule.rhs.size() == 1 && !nullable[rule.rhs[0]] && rule.copies;
+        pass_through[rule.lhs] = pass_through[rule.lhs] != 0 && copies;
+    }
+    for (size_t s = 0; s < n_symbols; ++s) {
+        if (pass_through[s] == 1) valued[s] = false;
+    }
+    return valued;
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <cctype>
+#include <cstring>
+#include <climits>
+#include <tuple>
+#include "util.h"
+
+// Character classes, one byte per input character.
+enum lexer_class {
+    LC_OTHER   = 0,
+    LC_SPACE   = 1,
+    LC_DIGIT   = 2,
+    LC_ALPHA   = 4,  // starts an identifier
+    LC_IDENT   = 8,  // continues an identifier
+    LC_COMMENT = 16, // starts a comment that runs to the end of the line
+};
+
+enum lexer_status {
+    LEX_TOKEN,
+    LEX_END,
+    LEX_UNKNOWN,  // no rule matched, offset points at the character
+    LEX_OVERFLOW, // number does not fit in an int, INT_MAX included
+    LEX_REJECTED, // the recognizer did not accept the token
+    LEX_ZERO,     // token value 0: an identifier the caller did not intern
+};
+
+// For error messages: "unknown token at offset 3".
+inline const char* lexer_status_name(lexer_status status) {
+    switch (status) {
+        case LEX_TOKEN:    return "token";
+        case LEX_END:      return "end of input";
+        case LEX_UNKNOWN:  return "unknown token";
+        case LEX_OVERFLOW: return "number too large";
+        case LEX_REJECTED: return "unexpected token";
+        case LEX_ZERO:     return "zero token value";
+    }
+    return "lexer error";
+}
+
+struct lexeme {
+    int symbol;
+    int value;
+    int offset;
+    int length;
+};
+
+// libmarpa token values are not 0, so a number token's value is the
+// number plus one; actions take it back off with number_value($0).
+inline int number_value(int token_value) { return token_value - 1; }
+
+// Token tables for a scanner. Literals are not copied, the strings must
+// outlive the table (string literals from create_lexer() do).
+template <int MaxLiterals = 32>
+class lexer_table {
+    public:
+        struct literal {
+            const char* str;
+            int         length;
+            int         symbol;
+            int         value;
+            int         next;   // next literal with the same first character
+        };
+    public:
+        lexer_table() : n_literals(0), number_symbol(-1), ident_symbol(-1) {
+            for (int c = 0; c < 256; ++c) {
+                classes[c] = LC_OTHER;
+                if (isspace(c))              classes[c] |= LC_SPACE;
+                if (isdigit(c))              classes[c] |= LC_DIGIT | LC_IDENT;
+                if (isalpha(c) || c == '_')  classes[c] |= LC_ALPHA | LC_IDENT;
+                first[c] = -1;
+            }
+        }
+
+        // Literals with the same first character are kept longest first,
+        // so "::=" wins over ":".
+        void add_literal(const char* str, int symbol, int value) {
+            if (n_literals == MaxLiterals) {
+                throw "lexer_table: too many literals";
+            }
+            int length = strlen(str);
+            if (length == 0) return;
+
+            literal& l = literals[n_literals];
+            l.str    = str;
+            l.length = length;
+            l.symbol = symbol;
+            l.value  = value;
+
+            int* link = &first[(unsigned char)str[0]];
+            while (*link != -1 && literals[*link].length >= length) {
+                link = &literals[*link].next;
+            }
+            l.next = *link;
+            *link  = n_literals++;
+        }
+
+        // Accepts the token_list returned by create_tokens().
+        template <class L>
+        void add_literals(const L& tokens) {
+            for (const auto& t : tokens) {
+                add_literal(std::get<0>(t).c_str(), std::get<1>(t), std::get<2>(t));
+            }
+        }
+
+        void number(int symbol) { number_symbol = symbol; }
+        void ident(int symbol)  { ident_symbol = symbol; }
+        void comment(char c)    { classes[(unsigned char)c] |= LC_COMMENT; }
+
+        void set_class(char c, int cls) { classes[(unsigned char)c] = cls; }
+        int  char_class(char c) const   { return classes[(unsigned char)c]; }
+
+        unsigned char classes[256];
+        int           first[256];
+        literal       literals[MaxLiterals];
+        int           n_literals;
+        int           number_symbol;
+        int           ident_symbol;
+};
+
+// Splits [first, last) into lexemes. Nothing is allocated; identifiers are
+// returned as (offset, length) and the caller decides how to intern them.
+template <class Table>
+class scanner {
+    public:
+        scanner(const Table& table, const char* first, const char* last)
+            : table(table), first(first), pos(first), last(last) {}
+
+        lexer_status next(lexeme& out) {
+            skip_space();
+
+            out.offset = pos - first;
+            out.length = 1;
+
+            if (pos == last) {
+                out.length = 0;
+                return LEX_END;
+            }
+
+            unsigned char c   = *pos;
+            int           cls = table.classes[c];
+
+            for (int i = table.first[c]; i != -1; i = table.literals[i].next) {
+                const typename Table::literal& l = table.literals[i];
+                if (last - pos < l.length || memcmp(pos, l.str, l.length) != 0) {
+                    continue;
+                }
+                // "null" is not a prefix match of "nullable"
+                if (pos + l.length != last
+                        && (table.classes[(unsigned char)l.str[l.length-1]] & LC_IDENT)
+                        && (table.classes[(unsigned char)pos[l.length]] & LC_IDENT)) {
+                    continue;
+                }
+                out.symbol = l.symbol;
+                out.value  = l.value;
+                out.length = l.length;
+                pos += l.length;
+                return LEX_TOKEN;
+            }
+
+            if ((cls & LC_DIGIT) && table.number_symbol >= 0) {
+                return scan_number(out);
+            }
+
+            if ((cls & LC_ALPHA) && table.ident_symbol >= 0) {
+                const char* begin = pos++;
+                while (pos != last && (table.classes[(unsigned char)*pos] & LC_IDENT)) {
+                    ++pos;
+                }
+                out.symbol = table.ident_symbol;
+                out.value  = 0;
+                out.length = pos - begin;
+                return LEX_TOKEN;
+            }
+
+            return LEX_UNKNOWN;
+        }
+
+        // Used by callers that lex part of the input themselves.
+        const char* position() const { return pos; }
+        void        seek(const char* p) { pos = p; }
+        int         offset() const { return pos - first; }
+    private:
+        void skip_space() {
+            while (pos != last) {
+                int cls = table.classes[(unsigned char)*pos];
+                if (cls & LC_SPACE) {
+                    ++pos;
+                }
+                else if (cls & LC_COMMENT) {
+                    const char* nl = (const char*)memchr(pos, '\n', last - pos);
+                    pos = nl ? nl + 1 : last;
+                }
+                else {
+                    break;
+                }
+            }
+        }
+
+        lexer_status scan_number(lexeme& out) {
+            const char* begin = pos;
+            scan_result<const char*, int> n = scan_decimal<int>(pos, last);
+            pos = n.next;
+            out.symbol = table.number_symbol;
+            out.length = pos - begin;
+            // INT_MAX has no room for the +1 of number_value()
+            if (n.status == SCAN_OVERFLOW || n.value == INT_MAX) {
+                out.value = 0;
+                return LEX_OVERFLOW;
+            }
+            out.value = n.value + 1;
+            return LEX_TOKEN;
+        }
+    private:
+        const Table& table;
+        const char*  first;
+        const char*  pos;
+        const char*  last;
+};
+
+// Reads tokens into the recognizer until the end of the input, the first
+// lexeme the table does not handle, or the first token the recognizer
+// rejects (LEX_REJECTED); that lexeme is left in `out`. An identifier
+// still has value 0 and stops with LEX_ZERO, the caller interns those.
+template <class R, class Table>
+lexer_status read_tokens(R& r, scanner<Table>& s, lexeme& out) {
+    lexer_status status;
+    while ((status = s.next(out)) == LEX_TOKEN) {
+        if (out.value == 0) return LEX_ZERO;
+        if (r.alternative(out.symbol, out.value, 1) != 0) return LEX_REJECTED;  // MARPA_ERR_NONE
+        r.earleme_complete();
+    }
+    return status;
+}
+
+#endif
@@ -116,6 +116,14 @@ class recognizer {
             start_input();
         }
 
+        // With use_leo false, right recursion is recognized without Leo's
+        // optimization. Uses libmarpa's internal API; for benchmarks.
+        recognizer(grammar& g, bool use_leo)
+            : handle(marpa_r_new(g.internal_handle())) {
+            _marpa_r_is_use_leo_set(handle, use_leo);
+            start_input();
+        }
+
         ~recognizer() {
             marpa_r_unref(handle);
         }
@@ -136,6 +144,11 @@ class recognizer {
             return marpa_r_latest_earley_set(handle);
         }
 
+        // Number of Earley items in a set; internal API as well.
+        inline int earley_set_size(earley_set_id set_id) {
+            return _marpa_r_earley_set_size(handle, set_id);
+        }
+
         int read(grammar::symbol_id sym_id, int value, int length) {
             if (value == 0) {
                 throw "value == 0";
@@ -224,6 +237,9 @@ class value {
         inline int rule() { return marpa_v_rule(handle); }
         inline grammar::symbol_id symbol() { return marpa_v_symbol(handle); }
         inline grammar::symbol_id token() { return marpa_v_token(handle); }
+        inline recognizer::earley_set_id es_id() { return marpa_v_es_id(handle); }
+        inline recognizer::earley_set_id rule_start_es_id() { return marpa_v_rule_start_es_id(handle); }
+        inline recognizer::earley_set_id token_start_es_id() { return marpa_v_token_start_es_id(handle); }
 
         value& operator=(const value&) = delete;
         value(const value&) = delete;
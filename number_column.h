@@ -0,0 +1,93 @@
+#ifndef NUMBER_COLUMN_H
+#define NUMBER_COLUMN_H
+
+#include <vector>
+#include <algorithm>
+#include "lexer.h"
+#include "util.h"
+#include "swar.h"
+
+// Reads `number (sep number)*` input into `column`, and the tokens into
+// the recognizer through read(const lexeme&), which returns false when
+// the token is rejected.
+//
+// The numbers go straight into the column, which is sized up front from
+// the number of separators. Every number is still a `number` token and
+// every separator a token of the table's literal for `sep`, so the
+// grammar checks the structure as it would with the scanner. A number
+// token's value is its 1-based position in the column, never 0. Anything
+// that is not a number or a separator after one goes through the table's
+// scanner.
+template <class Table, class Read>
+lexer_status read_number_column(const Table& table, char sep, const char* first, const char* last,
+                                std::vector<int>& column, Read read, lexeme& out) {
+    int sep_symbol = -1;
+    int sep_value  = 0;
+    for (int i = table.first[(unsigned char)sep]; i != -1; i = table.literals[i].next) {
+        if (table.literals[i].length == 1) {
+            sep_symbol = table.literals[i].symbol;
+            sep_value  = table.literals[i].value;
+        }
+    }
+
+    column.resize(swar_count(first, last, sep) + 1);
+    size_t n = 0;
+
+    scanner<Table> s(table, first, last);
+    const char* p = first;
+
+    for (;;) {
+        while (p != last && (table.classes[(unsigned char)*p] & LC_SPACE)) {
+            ++p;
+        }
+        if (p != last && (unsigned)(*p - '0') < 10) {
+            scan_result<const char*, int> number = scan_decimal<int>(p, last);
+            out.symbol = table.number_symbol;
+            out.offset = p - first;
+            out.length = number.next - p;
+            if (number.status == SCAN_OVERFLOW) {
+                out.value = 0;
+                column.resize(n);
+                return LEX_OVERFLOW;
+            }
+            // only malformed input has more numbers than separators
+            if (n == column.size()) column.resize(2 * n);
+            column[n++] = number.value;
+            out.value = n;
+            p = number.next;
+            if (!read(out)) {
+                column.resize(n);
+                return LEX_REJECTED;
+            }
+
+            if (sep_symbol != -1 && p != last && *p == sep) {
+                out = lexeme{ sep_symbol, sep_value, int(p - first), 1 };
+                ++p;
+                if (!read(out)) {
+                    column.resize(n);
+                    return LEX_REJECTED;
+                }
+            }
+            continue;
+        }
+
+        s.seek(p);
+        lexer_status status = s.next(out);
+        if (status != LEX_END && status != LEX_UNKNOWN && out.symbol == table.number_symbol) {
+            // after a comment; numbers always go through the column above
+            p = first + out.offset;
+            continue;
+        }
+        if (status != LEX_TOKEN) {
+            column.resize(n);
+            return status;
+        }
+        if (!read(out)) {
+            column.resize(n);
+            return LEX_REJECTED;
+        }
+        p = s.position();
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstring>
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Collects (pointer, length) spans and writes them out in batches, with
+// writev(2) to a file descriptor or with memcpy into a caller's buffer.
+// Nothing is copied before a flush, so the spans must stay valid until
+// then; render() output (literals in the program or the mapped template,
+// values in the bindings) does.
+//
+//   output_sink out(1);
+//   render(program, vars, out);
+//   out.flush();
+class output_sink {
+    public:
+        enum { batch_size = 256 };
+    public:
+        explicit output_sink(int fd)
+            : fd(fd), buf(0), capacity(0), used(0), total(0), n(0) {}
+
+        // Output that does not fit is counted in size() but dropped.
+        output_sink(char* buf, size_t capacity)
+            : fd(-1), buf(buf), capacity(capacity), used(0), total(0), n(0) {}
+
+        ~output_sink() {
+            try { if (n) flush_batch(); } catch (const char*) {}
+        }
+
+        void write(const char* p, size_t length) {
+            if (length == 0) return;
+            total += length;
+
+            if (n && (const char*)batch[n-1].iov_base + batch[n-1].iov_len == p) {
+                batch[n-1].iov_len += length;
+                return;
+            }
+            if (n == batch_size) flush_batch();
+            batch[n].iov_base = const_cast<char*>(p);
+            batch[n].iov_len  = length;
+            ++n;
+        }
+
+        void flush() { flush_batch(); }
+
+        // Bytes written so far, including the ones still in the batch.
+        size_t size() const { return total; }
+
+        // Buffer mode: bytes stored in the buffer, and whether any were dropped.
+        size_t stored() const   { return used; }
+        bool   overflow() const { return fd < 0 && total > capacity; }
+
+        void reset(char* b, size_t c) {
+            n = 0; buf = b; capacity = c; used = 0; total = 0;
+        }
+    private:
+        void flush_batch() {
+            if (fd < 0) {
+                for (int i = 0; i < n && used < capacity; ++i) {
+                    size_t k = batch[i].iov_len < capacity - used ? batch[i].iov_len : capacity - used;
+                    memcpy(buf + used, batch[i].iov_base, k);
+                    used += k;
+                }
+                n = 0;
+                return;
+            }
+
+            iovec* v    = batch;
+            int    left = n;
+            n = 0;
+            while (left > 0) {
+                ssize_t w = writev(fd, v, left);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    throw "output_sink: write failed";
+                }
+                // partial write: skip what went out and retry the rest
+                while (left > 0 && (size_t)w >= v->iov_len) {
+                    w -= v->iov_len;
+                    ++v;
+                    --left;
+                }
+                if (left > 0) {
+                    v->iov_base = (char*)v->iov_base + w;
+                    v->iov_len -= w;
+                }
+            }
+        }
+    private:
+        int    fd;
+        char*  buf;
+        size_t capacity;
+        size_t used;
+        size_t total;
+        iovec  batch[batch_size];
+        int    n;
+};
+
+#endif
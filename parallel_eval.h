@@ -0,0 +1,135 @@
+#ifndef PARALLEL_EVAL_H
+#define PARALLEL_EVAL_H
+
+#include <vector>
+#include <deque>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "marpa-cpp/marpa.hpp"
+#include "value_tape.h"
+
+// Evaluates every parse tree of `o` and stores evaluate(tape, worker) of
+// the n-th tree in results[n]. Returns the number of trees.
+//
+// libmarpa is not thread safe, so this thread walks the trees and records
+// each valuation into a value_tape, calling set_valued(v) first. The tapes
+// are queued for n_threads - 1 evaluation threads, started once for all
+// trees; with one thread this thread evaluates each tree as it records
+// it. `worker` is below n_threads, for per-thread contexts and stacks:
+//
+//   std::vector<std::vector<int>> stacks(threads);
+//   std::vector<int> values;
+//   parallel_trees(o, threads, set_valued, [&](const value_tape& tape, int worker) {
+//       value_tape::cursor c = tape.replay();
+//       ... evaluate_rules(g, r, c, stacks[worker]) on every step ...
+//       return stacks[worker][0];
+//   }, values);
+//
+// At most `in_flight` tapes are recorded and not yet evaluated; recording
+// waits for a free one. Every tree has its own tape, so evaluate must not
+// look at the others.
+template <class R, class S, class F>
+size_t parallel_trees(marpa::order& o, int n_threads, S set_valued, F evaluate, std::vector<R>& results,
+                      size_t in_flight = 256) {
+    marpa::tree t{o};
+    results.clear();
+
+    if (n_threads <= 1) {
+        value_tape tape;
+        while (t.next() >= 0) {
+            marpa::value v{t};
+            set_valued(v);
+            tape.record(v);
+            results.push_back(evaluate(tape, 0));
+        }
+        return results.size();
+    }
+
+    struct queued {
+        size_t tree;
+        size_t tape;
+    };
+
+    int evaluators = n_threads - 1;
+    if (in_flight < 1) in_flight = 1;
+
+    std::vector<value_tape> tapes(in_flight);
+    std::vector<size_t>     free_tapes;
+    std::deque<queued>      queue;
+    bool                    finished = false;
+    std::mutex              m;
+    std::condition_variable work_ready, tape_free;
+
+    for (size_t i = 0; i < in_flight; ++i) free_tapes.push_back(i);
+
+    // Each worker keeps its (tree, value) pairs; they go into results in
+    // tree order when every thread is done.
+    std::vector<std::vector<std::pair<size_t, R>>> values(evaluators);
+
+    auto worker = [&](int self) {
+        for (;;) {
+            queued q;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                work_ready.wait(lock, [&] { return !queue.empty() || finished; });
+                if (queue.empty()) return;
+                q = queue.front();
+                queue.pop_front();
+            }
+            values[self].push_back(std::make_pair(q.tree, evaluate(tapes[q.tape], self)));
+            {
+                std::lock_guard<std::mutex> lock(m);
+                free_tapes.push_back(q.tape);
+            }
+            tape_free.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < evaluators; ++i) {
+        threads.emplace_back(worker, i);
+    }
+
+    // A free tape belongs to this thread until it is queued.
+    size_t n = 0;
+    for (;;) {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            tape_free.wait(lock, [&] { return !free_tapes.empty(); });
+            slot = free_tapes.back();
+            free_tapes.pop_back();
+        }
+        if (t.next() < 0) break;
+
+        marpa::value v{t};
+        set_valued(v);
+        tapes[slot].record(v);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push_back(queued{ n++, slot });
+        }
+        work_ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m);
+        finished = true;
+    }
+    work_ready.notify_all();
+    for (std::thread& th : threads) {
+        th.join();
+    }
+
+    results.resize(n);
+    for (const auto& w : values) {
+        for (const auto& tv : w) {
+            results[tv.first] = tv.second;
+        }
+    }
+    return n;
+}
+
+#endif
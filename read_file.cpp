@@ -1,5 +1,10 @@
 #include <fstream>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "read_file.h"
 
 void read_file(const std::string& filename, std::string& input) {
     std::ifstream in(filename);
@@ -17,3 +22,30 @@ std::string read_file(const std::string& filename) {
     return input;
 }
 
+mapped_file::mapped_file(const std::string& filename) : first(0), length(0), mapped(false) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        length = st.st_size;
+        if (length == 0) {
+            first = "";
+        }
+        else {
+            void* p = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                first  = (const char*)p;
+                mapped = true;
+            }
+            else {
+                length = 0;
+            }
+        }
+    }
+    close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (mapped) munmap((void*)first, length);
+}
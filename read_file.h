@@ -1,7 +1,29 @@
 #ifndef READ_FILE_H
 #define READ_FILE_H
 
+#include <string>
+#include <cstddef>
+
 void read_file(const std::string& filename, std::string& input);
 std::string read_file(const std::string& filename);
 
+// Read-only mapping of a whole file. data() stays valid for the lifetime
+// of the object; it is 0 when the file could not be opened.
+class mapped_file {
+    public:
+        explicit mapped_file(const std::string& filename);
+        ~mapped_file();
+
+        const char* data() const { return first; }
+        size_t      size() const { return length; }
+        bool        ok() const   { return first != 0; }
+    private:
+        mapped_file(const mapped_file&);
+        mapped_file& operator=(const mapped_file&);
+    private:
+        const char* first;
+        size_t      length;
+        bool        mapped;
+};
+
 #endif
@@ -109,6 +109,13 @@ void output_rules(
     cout << "return tokens;\n";
     cout << "}\n";
 
+    cout << "template <typename T>\n";
+    cout << "void create_lexer(T& lex) {\n";
+    for (token_rule r : token_rules) {
+        cout << "\tlex.add_literal(\"" << strings[r.str] << "\", R_" << names[r.lhs] << ", 1);\n";
+    }
+    cout << "}\n";
+
     cout << "void evaluate_rules(marpa::grammar& g, marpa::recognizer& r, marpa::value& v, std::vector<int>& stack) {\n";
     cout << "\tusing rule = marpa::grammar::rule_id;\n";
     cout << "\trule rule_id = v.rule();\n";
@@ -0,0 +1,65 @@
+#ifndef SWAR_H
+#define SWAR_H
+
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+// Decimal digits eight bytes at a time in a uint64_t ("SIMD within a
+// register"). Byte 0 of a loaded word is the first character, whatever
+// the host byte order.
+
+inline uint64_t swar_load(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// Number of leading decimal digits in the word, 0 to 8.
+inline int swar_digit_count(uint64_t v) {
+    uint64_t t = v ^ 0x3030303030303030ull;   // digits become 0..9
+    // the high bit of a byte is set when it is not 0..9; masking first
+    // keeps the add from carrying into the next byte
+    uint64_t non_digit = (((t & 0x7f7f7f7f7f7f7f7full) + 0x7676767676767676ull) | t) & 0x8080808080808080ull;
+    return non_digit ? __builtin_ctzll(non_digit) >> 3 : 8;
+}
+
+// Value of the first n (1 to 8) bytes of the word, which are digits.
+inline uint32_t swar_parse_digits(uint64_t v, int n) {
+    // the digits move to the top, the bytes shifted in read as leading zeros
+    v = (v & 0x0f0f0f0f0f0f0f0full) << (8 * (8 - n));
+    v = (v * 10 + (v >> 8)) & 0x00ff00ff00ff00ffull;            // pairs
+    v = (v * 100 + (v >> 16)) & 0x0000ffff0000ffffull;          // quads
+    return uint32_t(v * 10000 + (v >> 32));
+}
+
+// Number of bytes equal to c in [first, last).
+inline size_t swar_count(const char* first, const char* last, char c) {
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t pattern = ones * (unsigned char)c;
+    size_t n = 0;
+    while (last - first >= 8) {
+        // per-byte counters, folded before any of them can reach 256
+        uint64_t counts = 0;
+        for (int i = 0; i < 255 && last - first >= 8; ++i, first += 8) {
+            uint64_t t = swar_load(first) ^ pattern;   // matches become 0
+            uint64_t nonzero = ((t & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | t;
+            counts += (~nonzero >> 7) & ones;
+        }
+        counts = (counts & 0x00ff00ff00ff00ffull) + ((counts >> 8) & 0x00ff00ff00ff00ffull);
+        n += (counts * 0x0001000100010001ull) >> 48;
+    }
+    for (; first != last; ++first) {
+        n += *first == c;
+    }
+    return n;
+}
+
+const uint32_t swar_pow10[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+};
+
+#endif
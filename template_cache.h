@@ -0,0 +1,214 @@
+#ifndef TEMPLATE_CACHE_H
+#define TEMPLATE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include "read_file.h"
+#include "template_vm.h"
+
+// Compiled templates on disk, so a warm start skips lexing, Marpa and the
+// compiler. The file is mapped and rendered from in place:
+//
+//   header | code[n_code] | name_offsets[n_slots+1] | names | text
+//
+// All numbers are in host byte order. A cache belongs to one source file
+// by its size and FNV-1a hash; anything that does not check out (other
+// source, other version, truncated, corrupt) is treated as a miss.
+
+const char     template_cache_magic[8] = { 'M', 'T', 'P', 'L', 'C', 'A', 'C', 'H' };
+const uint32_t template_cache_version  = 1;
+
+struct template_cache_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t n_code;
+    uint32_t n_slots;
+    uint32_t names_offset;    // of name_offsets, from the start of the file
+    uint32_t names_size;      // bytes of names
+    uint32_t text_offset;
+    uint32_t text_size;
+    uint32_t reserved[2];
+};
+
+inline uint64_t fnv1a_64(const char* p, size_t n) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Checks everything render() relies on: jump targets, literal spans,
+// slots, properly nested blocks and the final OP_HALT.
+inline bool template_verify(const template_program_view& p, uint32_t text_size) {
+    if (p.n_code == 0 || p.code[p.n_code-1].op != OP_HALT) return false;
+
+    struct block {
+        bool     loop;
+        uint32_t begin;
+        uint32_t end;   // first pc after the block
+    };
+    std::vector<block> open;
+    int loops = 0;
+
+    for (uint32_t pc = 0; pc < p.n_code; ++pc) {
+        while (!open.empty() && !open.back().loop && open.back().end == pc) {
+            open.pop_back();
+        }
+        // a loop body ends before its OP_FOR_NEXT
+        uint32_t limit = open.empty() ? p.n_code - 1 : open.back().end - open.back().loop;
+
+        const template_instr& in = p.code[pc];
+        switch (in.op) {
+            case OP_EMIT_LIT:
+                if (in.a > text_size || in.b > text_size - in.a) return false;
+                break;
+            case OP_EMIT_VAR:
+                if (in.a >= p.n_slots) return false;
+                break;
+            case OP_JUMP_IF_FALSE:
+                if (in.a >= p.n_slots || in.b <= pc || in.b > limit) return false;
+                open.push_back(block{ false, pc, in.b });
+                break;
+            case OP_FOR_BEGIN:
+                if (in.a >= p.n_slots || in.b >= p.n_slots || in.c <= pc + 1 || in.c > limit) return false;
+                if (++loops > template_max_loop_depth) return false;
+                open.push_back(block{ true, pc, in.c });
+                break;
+            case OP_FOR_NEXT:
+                if (open.empty() || !open.back().loop || open.back().end != pc + 1) return false;
+                if (in.c != open.back().begin + 1) return false;
+                open.pop_back();
+                --loops;
+                break;
+            case OP_HALT:
+                if (pc != p.n_code - 1) return false;
+                break;
+            default:
+                return false;
+        }
+    }
+    return open.empty();
+}
+
+// Literal spans of the source are copied into the cache's text section.
+inline bool write_template_cache(const std::string& filename, const template_program& p,
+                                 const char* source, size_t source_size) {
+    std::vector<template_instr> code(p.code);
+    std::string text;
+    for (template_instr& in : code) {
+        if (in.op == OP_EMIT_LIT) {
+            uint32_t at = text.size();
+            text.append(p.text() + in.a, in.b);
+            in.a = at;
+        }
+    }
+
+    std::vector<uint32_t> name_offsets;
+    std::string names;
+    for (const std::string& n : p.names) {
+        name_offsets.push_back(names.size());
+        names.append(n);
+    }
+    name_offsets.push_back(names.size());
+
+    template_cache_header h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, template_cache_magic, sizeof h.magic);
+    h.version      = template_cache_version;
+    h.header_size  = sizeof h;
+    h.source_hash  = fnv1a_64(source, source_size);
+    h.source_size  = source_size;
+    h.n_code       = code.size();
+    h.n_slots      = p.names.size();
+    h.names_offset = sizeof h + code.size() * sizeof(template_instr);
+    h.names_size   = names.size();
+    h.text_offset  = h.names_offset + name_offsets.size() * sizeof(uint32_t) + names.size();
+    h.text_size    = text.size();
+
+    // Write a temporary file and rename it, so readers never see half a cache.
+    std::string tmp = filename + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(&h, sizeof h, 1, f) == 1
+        && fwrite(code.data(), sizeof(template_instr), code.size(), f) == code.size()
+        && fwrite(name_offsets.data(), sizeof(uint32_t), name_offsets.size(), f) == name_offsets.size()
+        && fwrite(names.data(), 1, names.size(), f) == names.size()
+        && fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A mapped cache file. ok() is false on a miss; view() and slot() are only
+// valid after a hit.
+class template_cache {
+    public:
+        template_cache(const std::string& filename, const char* source, size_t source_size)
+            : file(filename), valid(false), name_offsets(0), names(0)
+        {
+            memset(&p, 0, sizeof p);
+            if (!file.ok() || file.size() < sizeof(template_cache_header)) return;
+
+            template_cache_header h;
+            memcpy(&h, file.data(), sizeof h);
+            if (memcmp(h.magic, template_cache_magic, sizeof h.magic) != 0
+                    || h.version != template_cache_version
+                    || h.header_size != sizeof h
+                    || h.source_size != source_size) {
+                return;
+            }
+
+            uint64_t code_end  = sizeof h + uint64_t(h.n_code) * sizeof(template_instr);
+            uint64_t names_end = uint64_t(h.names_offset) + (uint64_t(h.n_slots) + 1) * sizeof(uint32_t) + h.names_size;
+            if (h.n_slots == 0 || h.names_offset != code_end || h.text_offset != names_end
+                    || uint64_t(h.text_offset) + h.text_size != file.size()) {
+                return;
+            }
+            if (fnv1a_64(source, source_size) != h.source_hash) return;
+
+            name_offsets = (const uint32_t*)(file.data() + h.names_offset);
+            names        = (const char*)(name_offsets + h.n_slots + 1);
+            for (uint32_t i = 0; i < h.n_slots; ++i) {
+                if (name_offsets[i] > name_offsets[i+1] || name_offsets[i+1] > h.names_size) return;
+            }
+
+            p.code    = (const template_instr*)(file.data() + sizeof h);
+            p.n_code  = h.n_code;
+            p.text    = file.data() + h.text_offset;
+            p.n_slots = h.n_slots;
+            valid     = template_verify(p, h.text_size);
+        }
+
+        bool ok() const { return valid; }
+
+        const template_program_view& view() const { return p; }
+
+        int slot(const std::string& name) const {
+            for (uint32_t i = 1; i < p.n_slots; ++i) {
+                if (name_offsets[i+1] - name_offsets[i] == name.size()
+                        && memcmp(names + name_offsets[i], name.data(), name.size()) == 0) {
+                    return i;
+                }
+            }
+            return 0;
+        }
+    private:
+        mapped_file           file;
+        bool                  valid;
+        template_program_view p;
+        const uint32_t*       name_offsets;
+        const char*           names;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef TEMPLATE_CPP_H
+#define TEMPLATE_CPP_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <ostream>
+#include <cstdio>
+#include "template_vm.h"
+
+// Translates a compiled template into C++ source, the way testmarpa turns
+// a grammar into C++. The output has
+//
+//   namespace <ns> {
+//       struct vars { template_value name; ... };
+//       template <class W> void render(const vars& v, W& out);
+//   }
+//
+// with every literal a static const char[], every free variable a field
+// of vars and every {{for}} a native loop. The bytecode only nests, so
+// jump targets map back to closing braces. A variable named like a C++
+// keyword, or like vars and template_value, gets a trailing underscore:
+// {{class}} is the field class_.
+
+inline void write_cpp_string(std::ostream& out, const char* s, size_t n) {
+    out << '"';
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = s[i];
+        switch (c) {
+            case '\n': out << "\\n";  break;
+            case '\t': out << "\\t";  break;
+            case '\r': out << "\\r";  break;
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '?':  out << (i > 0 && s[i-1] == '?' ? "\\?" : "?"); break;  // trigraphs
+            default:
+                if (c < 32 || c >= 127) {
+                    char buf[8];
+                    snprintf(buf, sizeof buf, "\\%03o", c);
+                    out << buf;
+                }
+                else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+// Template names are identifiers, but not all of them can be fields.
+inline bool cpp_reserved(const std::string& name) {
+    static const char* const words[] = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+        "bool", "break", "case", "catch", "char", "char16_t", "char32_t", "class",
+        "compl", "const", "const_cast", "constexpr", "continue", "decltype", "default",
+        "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+        "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int",
+        "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr",
+        "operator", "or", "or_eq", "private", "protected", "public", "register",
+        "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template", "this",
+        "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+        "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t",
+        "while", "xor", "xor_eq",
+        "vars", "template_value",   // the struct and the field type
+    };
+    for (const char* w : words) {
+        if (name == w) return true;
+    }
+    return false;
+}
+
+inline void write_cpp(const template_program& p, const std::string& ns, std::ostream& out) {
+    struct loop {
+        uint32_t    var;
+        std::string expr;
+        bool        bound;
+    };
+
+    std::vector<std::string> expr(p.names.size());
+    std::vector<bool>        bound(p.names.size(), false);  // by an enclosing loop
+    std::vector<bool>        field(p.names.size(), false);
+    std::vector<std::string> fields(p.names.size());
+    for (size_t i = 1; i < p.names.size(); ++i) {
+        fields[i] = p.names[i];
+        // until it is neither reserved nor another variable, class_ may exist
+        while (cpp_reserved(fields[i]) || (fields[i] != p.names[i] && p.slot(fields[i]) != 0)) {
+            fields[i] += '_';
+        }
+        expr[i] = "v." + fields[i];
+    }
+
+    std::ostringstream literals, body;
+    std::vector<uint32_t> closes;
+    std::vector<loop>     loops;
+    int n_literals = 0, n_loops = 0;
+
+    auto use = [&](uint32_t slot) -> const std::string& {
+        if (!bound[slot]) field[slot] = true;
+        return expr[slot];
+    };
+    auto indent = [&]() -> std::ostream& {
+        for (size_t i = 0; i < closes.size() + loops.size() + 1; ++i) body << "    ";
+        return body;
+    };
+
+    for (uint32_t pc = 0; pc < p.code.size(); ++pc) {
+        while (!closes.empty() && closes.back() == pc) {
+            closes.pop_back();
+            indent() << "}\n";
+        }
+
+        const template_instr& in = p.code[pc];
+        switch (in.op) {
+            case OP_EMIT_LIT: {
+                int n = n_literals++;
+                literals << "static const char lit_" << n << "[] = ";
+                write_cpp_string(literals, p.text() + in.a, in.b);
+                literals << ";\n";
+                indent() << "out.write(lit_" << n << ", sizeof(lit_" << n << ") - 1);\n";
+                break;
+            }
+            case OP_EMIT_VAR: {
+                const std::string& e = use(in.a);
+                indent() << "out.write(" << e << ".str, " << e << ".length);\n";
+                break;
+            }
+            case OP_JUMP_IF_FALSE:
+                indent() << "if (" << use(in.a) << ".length) {\n";
+                closes.push_back(in.b);
+                break;
+            case OP_FOR_BEGIN: {
+                int n = n_loops++;
+                const std::string& list = use(in.a);
+                indent() << "for (uint32_t i_" << n << " = 0; i_" << n << " < " << list << ".count; ++i_" << n << ") {\n";
+                loops.push_back(loop{ in.b, expr[in.b], bound[in.b] });
+                indent() << "const template_value& item_" << n << " = " << list << ".items[i_" << n << "];\n";
+
+                std::ostringstream item;
+                item << "item_" << n;
+                expr[in.b]  = item.str();
+                bound[in.b] = true;
+                break;
+            }
+            case OP_FOR_NEXT: {
+                loop& l = loops.back();
+                expr[l.var]  = l.expr;
+                bound[l.var] = l.bound;
+                loops.pop_back();
+                indent() << "}\n";
+                break;
+            }
+            case OP_HALT:
+                break;
+        }
+    }
+
+    out << "// Generated by template --cpp, do not edit.\n"
+        << "#include <stdint.h>\n"
+        << "#include \"template_vm.h\"\n\n"
+        << "namespace " << ns << " {\n\n"
+        << "struct vars {\n";
+    for (size_t i = 1; i < p.names.size(); ++i) {
+        if (field[i]) out << "    template_value " << fields[i] << ";\n";
+    }
+    out << "};\n\n"
+        << literals.str() << "\n"
+        << "template <class W>\n"
+        << "void render(const vars& v, W& out) {\n"
+        << body.str()
+        << "}\n\n"
+        << "}\n";
+}
+
+#endif
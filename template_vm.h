@@ -0,0 +1,221 @@
+#ifndef TEMPLATE_VM_H
+#define TEMPLATE_VM_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+// Bytecode for templates. Compile the parse tree once into a
+// template_program, then render() it as often as needed; rendering walks
+// a flat instruction array and does not allocate.
+enum template_opcode {
+    OP_EMIT_LIT,        // write text()[a, a+b)
+    OP_EMIT_VAR,        // write the value of slot a
+    OP_JUMP_IF_FALSE,   // if slot a is empty, jump to b
+    OP_FOR_BEGIN,       // loop slot b over the items of slot a, jump to c if there are none
+    OP_FOR_NEXT,        // next item of the innermost loop, jump to c while there is one
+    OP_HALT,
+};
+
+struct template_instr {
+    uint32_t op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+// Loops nested deeper than this are rejected by the compiler, so render()
+// can keep its loop frames on the stack.
+const int template_max_loop_depth = 16;
+
+// A variable is a string and a list of items; "for" iterates the items,
+// everything else uses the string. An empty string is false for "if".
+struct template_value {
+    const char*           str;
+    uint32_t              length;
+    const template_value* items;
+    uint32_t              count;
+};
+
+// What render() needs of a program; the storage can be a template_program
+// or a mapped cache file (template_cache.h).
+struct template_program_view {
+    const template_instr* code;
+    uint32_t              n_code;
+    const char*           text;
+    uint32_t              n_slots;
+};
+
+// Slot 0 is unused, slots match the indices of the compiler's name table.
+// Literals are spans of the template source when it outlives the
+// program (a mapped file), otherwise they are copied into the pool.
+struct template_program {
+    std::vector<template_instr> code;
+    std::string                 pool;
+    const char*                 source;
+    std::vector<std::string>    names;  // slot -> variable name
+
+    template_program() : source(0) {}
+
+    const char* text() const { return source ? source : pool.data(); }
+
+    template_program_view view() const {
+        return template_program_view{ code.data(), uint32_t(code.size()), text(), uint32_t(names.size()) };
+    }
+
+    int slot(const std::string& name) const {
+        for (size_t i = 1; i < names.size(); ++i) {
+            if (names[i] == name) return i;
+        }
+        return 0;
+    }
+};
+
+class template_bindings {
+    public:
+        template_bindings(const template_program& p) : slots(p.names.size(), template_value{ "", 0, 0, 0 }) {}
+        explicit template_bindings(size_t n_slots) : slots(n_slots, template_value{ "", 0, 0, 0 }) {}
+
+        void set(int slot, const char* str, uint32_t length) {
+            slots[slot] = template_value{ str, length, 0, 0 };
+        }
+        void set(int slot, const template_value& v) {
+            slots[slot] = v;
+        }
+
+        template_value&       operator[](int slot)       { return slots[slot]; }
+        const template_value& operator[](int slot) const { return slots[slot]; }
+    private:
+        std::vector<template_value> slots;
+};
+
+// Builds a program; the jump targets of if and for are patched when the
+// body has been emitted.
+class template_compiler {
+    public:
+        template_compiler(template_program& p) : p(p), depth(0) {}
+
+        void literal(const std::string& s) {
+            if (p.source) {
+                throw "template: literal copied into a program with a source";
+            }
+            if (s.empty()) return;
+            emit(OP_EMIT_LIT, p.pool.size(), s.size(), 0);
+            p.pool.append(s);
+        }
+
+        // A span of p.source.
+        void literal(uint32_t offset, uint32_t length) {
+            if (!p.source) {
+                throw "template: literal span without a source";
+            }
+            if (length == 0) return;
+            emit(OP_EMIT_LIT, offset, length, 0);
+        }
+
+        void var(int slot) { emit(OP_EMIT_VAR, use(slot), 0, 0); }
+
+        uint32_t begin_if(int slot) { return emit(OP_JUMP_IF_FALSE, use(slot), 0, 0); }
+        void     end_if(uint32_t at) { p.code[at].b = p.code.size(); }
+
+        uint32_t begin_for(int list, int var) {
+            if (++depth > template_max_loop_depth) {
+                throw "template: loops nested too deep";
+            }
+            return emit(OP_FOR_BEGIN, use(list), use(var), 0);
+        }
+        void end_for(uint32_t at) {
+            --depth;
+            emit(OP_FOR_NEXT, 0, 0, at + 1);
+            p.code[at].c = p.code.size();
+        }
+
+        void finish() { emit(OP_HALT, 0, 0, 0); }
+    private:
+        uint32_t emit(uint32_t op, uint32_t a, uint32_t b, uint32_t c) {
+            p.code.push_back(template_instr{ op, a, b, c });
+            return p.code.size() - 1;
+        }
+        int use(int slot) {
+            if ((size_t)slot >= p.names.size()) {
+                throw "template: unnamed variable slot";
+            }
+            return slot;
+        }
+    private:
+        template_program& p;
+        int               depth;
+};
+
+// W needs write(const char*, size); std::ostream will do. Loop variables
+// are bound in `vars` while their loop runs and restored afterwards.
+template <class W>
+void render(const template_program_view& p, template_bindings& vars, W& out) {
+    struct frame {
+        const template_value* items;
+        uint32_t              count;
+        uint32_t              i;
+        uint32_t              var;
+        template_value        saved;
+    };
+    frame loops[template_max_loop_depth];
+    int   top = -1;
+
+    const template_instr* code = p.code;
+    const char*           text = p.text;
+    uint32_t pc = 0;
+
+    for (;;) {
+        const template_instr& in = code[pc++];
+        switch (in.op) {
+            case OP_EMIT_LIT:
+                out.write(text + in.a, in.b);
+                break;
+            case OP_EMIT_VAR: {
+                const template_value& v = vars[in.a];
+                out.write(v.str, v.length);
+                break;
+            }
+            case OP_JUMP_IF_FALSE:
+                if (vars[in.a].length == 0) pc = in.b;
+                break;
+            case OP_FOR_BEGIN: {
+                const template_value& list = vars[in.a];
+                if (list.count == 0) {
+                    pc = in.c;
+                    break;
+                }
+                frame& f = loops[++top];
+                f.items = list.items;
+                f.count = list.count;
+                f.i     = 0;
+                f.var   = in.b;
+                f.saved = vars[in.b];
+                vars[in.b] = f.items[0];
+                break;
+            }
+            case OP_FOR_NEXT: {
+                frame& f = loops[top];
+                if (++f.i < f.count) {
+                    vars[f.var] = f.items[f.i];
+                    pc = in.c;
+                }
+                else {
+                    vars[f.var] = f.saved;
+                    --top;
+                }
+                break;
+            }
+            case OP_HALT:
+                return;
+        }
+    }
+}
+
+template <class W>
+void render(const template_program& p, template_bindings& vars, W& out) {
+    render(p.view(), vars, out);
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef TOKEN_LOG_H
+#define TOKEN_LOG_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "marpa-cpp/marpa.hpp"
+#include "lexer.h"
+
+struct source_location {
+    int line;   // 1-based
+    int column; // 1-based, in bytes
+};
+
+// Every token read into the recognizer, stored as parallel arrays, with
+// the Earley set it started at. Line and column are only computed when
+// asked for, from an index of the newlines in the input.
+class token_log {
+    public:
+        token_log(const char* first, const char* last)
+            : first(first), last(last), indexed(false) {}
+
+        template <class R>
+        int read(R& r, const lexeme& t) {
+            int es  = r.latest_earley_set();
+            int err = r.alternative(t.symbol, t.value, 1);
+            if (err != MARPA_ERR_NONE) {
+                return err;
+            }
+            add(es, t);
+            r.earleme_complete();
+            return MARPA_ERR_NONE;
+        }
+
+        void add(int earley_set, const lexeme& t) {
+            if ((int)first_token.size() <= earley_set) {
+                first_token.resize(earley_set + 1, -1);
+            }
+            if (first_token[earley_set] == -1) {
+                first_token[earley_set] = symbols.size();
+            }
+            symbols.push_back(t.symbol);
+            values.push_back(t.value);
+            offsets.push_back(t.offset);
+            lengths.push_back(t.length);
+        }
+
+        void reserve(size_t n) {
+            symbols.reserve(n);
+            values.reserve(n);
+            offsets.reserve(n);
+            lengths.reserve(n);
+        }
+
+        int size() const { return symbols.size(); }
+
+        int symbol(int i) const { return symbols[i]; }
+        int value(int i)  const { return values[i]; }
+        int offset(int i) const { return offsets[i]; }
+        int length(int i) const { return lengths[i]; }
+
+        const char* text(int i) const { return first + offsets[i]; }
+        std::string str(int i) const  { return std::string(text(i), lengths[i]); }
+
+        // First token that starts at an Earley set, -1 when there is none.
+        // Use with marpa::value::token_start_es_id() or rule_start_es_id().
+        int token_at(int earley_set) const {
+            if (earley_set < 0 || earley_set >= (int)first_token.size()) {
+                return -1;
+            }
+            return first_token[earley_set];
+        }
+
+        source_location where(int i) const {
+            return location_of(offsets[i]);
+        }
+
+        source_location location_of(int offset) const {
+            if (!indexed) {
+                index_newlines();
+            }
+            auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+            int line = it - newlines.begin();
+            int bol  = line == 0 ? 0 : newlines[line-1] + 1;
+            return source_location{ line + 1, offset - bol + 1 };
+        }
+    private:
+        void index_newlines() const {
+            const char* p = first;
+#ifdef __SSE2__
+            const __m128i nl = _mm_set1_epi8('\n');
+            for (; last - p >= 16; p += 16) {
+                __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+                while (mask) {
+                    newlines.push_back(p - first + __builtin_ctz(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif
+            while ((p = (const char*)memchr(p, '\n', last - p)) != 0) {
+                newlines.push_back(p - first);
+                ++p;
+            }
+            indexed = true;
+        }
+    private:
+        const char*              first;
+        const char*              last;
+
+        std::vector<int>         symbols;
+        std::vector<int>         values;
+        std::vector<int>         offsets;
+        std::vector<int>         lengths;
+        std::vector<int>         first_token; // Earley set -> token index
+
+        mutable std::vector<int> newlines;
+        mutable bool             indexed;
+};
+
+// Like read_tokens(), but records every token in the log. Stops with
+// LEX_REJECTED when the recognizer does not accept a token.
+template <class R, class Table>
+lexer_status read_tokens(R& r, scanner<Table>& s, token_log& log, lexeme& out) {
+    lexer_status status;
+    while ((status = s.next(out)) == LEX_TOKEN) {
+        if (out.value == 0) {
+            return LEX_ZERO;
+        }
+        if (log.read(r, out) != MARPA_ERR_NONE) {
+            return LEX_REJECTED;
+        }
+    }
+    return status;
+}
+
+#endif
@@ -36,8 +36,15 @@
 #include <queue>
 #include <algorithm>
 #include <cstddef>
+#include <type_traits>
 
 
+/// Allocators that can free all of their nodes at once specialise this to
+/// std::true_type; tree::clear() then destroys the nodes and releases the
+/// allocator's memory in one go instead of erasing node by node.
+template<class tree_node_allocator>
+struct tree_allocator_bulk_release : std::false_type {};
+
 /// A node in the tree, combining links to other nodes as well as the actual data.
 template<class T>
 class tree_node_ { // size: 5*4=20 bytes (on 32 bit arch), can be reduced by 8.
@@ -415,6 +422,8 @@ class tree {
             tree_node_allocator alloc_;
             void head_initialise_();
             void copy_(const tree<T, tree_node_allocator>& other);
+            void clear_(std::false_type);
+            void clear_(std::true_type);
 
             /// Comparator class for two nodes of a tree (used for sorting and searching).
             template<class StrictWeakOrdering>
@@ -565,8 +574,31 @@ class tree {
             void tree<T, tree_node_allocator>::clear()
             {
                 if(head)
-                    while(head->next_sibling!=feet)
-                        erase(pre_order_iterator(head->next_sibling));
+                    clear_(tree_allocator_bulk_release<tree_node_allocator>());
+            }
+
+        template <class T, class tree_node_allocator>
+            void tree<T, tree_node_allocator>::clear_(std::false_type)
+            {
+                while(head->next_sibling!=feet)
+                    erase(pre_order_iterator(head->next_sibling));
+            }
+
+        template <class T, class tree_node_allocator>
+            void tree<T, tree_node_allocator>::clear_(std::true_type)
+            {
+                if(head->next_sibling==feet) return;
+                // post-order, so a node is destroyed after everything that links through it
+                post_order_iterator it=begin_post();
+                while(it!=end_post()) {
+                    tree_node *cur=it.node;
+                    ++it;
+                    alloc_.destroy(cur);
+                }
+                alloc_.destroy(head);
+                alloc_.destroy(feet);
+                alloc_.release();
+                head_initialise_();
             }
 
         template<class T, class tree_node_allocator> 
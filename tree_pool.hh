@@ -0,0 +1,154 @@
+// Slab allocator for tree.hh nodes.
+//
+//   tree<node, tree_pool_allocator<tree_node_<node> > > t;
+//
+// Every tree owns its allocator, so every tree has its own free list.
+// Nodes come from slabs of a fixed size; erased nodes go onto the free
+// list and are reused. tree::clear() releases all slabs at once, see
+// tree_allocator_bulk_release in tree.hh.
+//
+// With HugePages the slabs are 2 MiB mappings, backed by huge pages when
+// the system has them (MAP_HUGETLB, then MADV_HUGEPAGE), otherwise by
+// normal pages.
+//
+// calctree builds its AST on compact_tree.hh now; the pool is for code
+// that stays on tree.hh. bench-calctree-build keeps the old pooled
+// tree.hh builder as its baseline.
+
+#ifndef tree_pool_hh_
+#define tree_pool_hh_
+
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+#include "tree.hh"
+
+template<class T, bool HugePages = false>
+class tree_pool_allocator {
+    public:
+        typedef T                 value_type;
+        typedef T*                pointer;
+        typedef const T*          const_pointer;
+        typedef T&                reference;
+        typedef const T&          const_reference;
+        typedef size_t            size_type;
+        typedef ptrdiff_t         difference_type;
+
+        template<class U>
+        struct rebind { typedef tree_pool_allocator<U, HugePages> other; };
+
+        tree_pool_allocator() : free_list_(0), slabs_(0), next_(0), end_(0) {}
+        // Copies start with an empty pool; nodes are never shared between trees.
+        tree_pool_allocator(const tree_pool_allocator&) : free_list_(0), slabs_(0), next_(0), end_(0) {}
+        template<class U>
+        tree_pool_allocator(const tree_pool_allocator<U, HugePages>&) : free_list_(0), slabs_(0), next_(0), end_(0) {}
+        ~tree_pool_allocator() { release(); }
+
+        tree_pool_allocator& operator=(const tree_pool_allocator&) { return *this; }
+
+        pointer allocate(size_type n, const void* = 0) {
+            if(n!=1)
+                return static_cast<pointer>(::operator new(n*sizeof(T)));
+            if(free_list_) {
+                free_slot *s=free_list_;
+                free_list_=s->next;
+                return reinterpret_cast<pointer>(s);
+            }
+            if(next_==end_)
+                add_slab_();
+            pointer p=reinterpret_cast<pointer>(next_);
+            next_+=slot_size;
+            return p;
+        }
+
+        void deallocate(pointer p, size_type n) {
+            if(n!=1) {
+                ::operator delete(p);
+                return;
+            }
+            free_slot *s=reinterpret_cast<free_slot *>(p);
+            s->next=free_list_;
+            free_list_=s;
+        }
+
+        void construct(pointer p, const T& val) { new(static_cast<void *>(p)) T(val); }
+        void destroy(pointer p) { p->~T(); }
+
+        size_type max_size() const { return size_type(-1)/sizeof(T); }
+
+        /// Return every slab to the system. All nodes must have been destroyed.
+        void release() {
+            while(slabs_) {
+                slab *s=slabs_;
+                slabs_=s->next;
+                free_slab_(s);
+            }
+            free_list_=0;
+            next_=end_=0;
+        }
+
+        bool operator==(const tree_pool_allocator& other) const { return this==&other; }
+        bool operator!=(const tree_pool_allocator& other) const { return this!=&other; }
+
+    private:
+        struct free_slot { free_slot *next; };
+        struct slab {
+            slab   *next;
+            size_t  bytes;
+            bool    mapped;
+        };
+
+        static const size_t slot_size   = (sizeof(T)+alignof(T)-1)/alignof(T)*alignof(T) < sizeof(free_slot)
+                                          ? sizeof(free_slot)
+                                          : (sizeof(T)+alignof(T)-1)/alignof(T)*alignof(T);
+        static const size_t header_size = (sizeof(slab)+alignof(std::max_align_t)-1)/alignof(std::max_align_t)*alignof(std::max_align_t);
+        static const size_t slab_bytes  = HugePages ? 2*1024*1024 : 64*1024;
+
+        void add_slab_() {
+            slab *s=0;
+            if(HugePages) {
+                void *p=mmap(0, slab_bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS
+#ifdef MAP_HUGETLB
+                        |MAP_HUGETLB
+#endif
+                        , -1, 0);
+                if(p==MAP_FAILED) {
+                    p=mmap(0, slab_bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+                    if(p==MAP_FAILED)
+                        throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+                    madvise(p, slab_bytes, MADV_HUGEPAGE);
+#endif
+                }
+                s=static_cast<slab *>(p);
+                s->mapped=true;
+            }
+            else {
+                s=static_cast<slab *>(::operator new(slab_bytes));
+                s->mapped=false;
+            }
+            s->bytes=slab_bytes;
+            s->next=slabs_;
+            slabs_=s;
+
+            char *first=reinterpret_cast<char *>(s)+header_size;
+            next_=first;
+            end_=first+(slab_bytes-header_size)/slot_size*slot_size;
+        }
+
+        static void free_slab_(slab *s) {
+            if(s->mapped)
+                munmap(s, s->bytes);
+            else
+                ::operator delete(s);
+        }
+
+        free_slot *free_list_;
+        slab      *slabs_;
+        char      *next_, *end_;
+};
+
+template<class T, bool HugePages>
+struct tree_allocator_bulk_release<tree_pool_allocator<T, HugePages> > : std::true_type {};
+
+#endif
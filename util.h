@@ -1,24 +1,155 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cctype>
+#include <stdint.h>
+#include "swar.h"
+
+enum scan_status {
+    SCAN_OK,
+    SCAN_NO_DIGITS,  // next is where the scan started
+    SCAN_OVERFLOW,   // next is after all the digits, value is 0
+};
+
+template <class I, class N>
+struct scan_result {
+    I           next;
+    N           value;
+    scan_status status;
+};
+
+// 0-9 for digits, 10-35 for letters, 36 otherwise.
+inline int digit_value(char c) {
+    unsigned d = (unsigned char)c - '0';
+    if (d < 10) return d;
+    d = ((unsigned char)c | 0x20) - 'a';
+    return d < 26 ? d + 10 : 36;
+}
+
+// Scans digits in `base` (2 to 36) into a non-negative N, checked
+// against std::numeric_limits<N>::max(). Stops at the first character
+// that is not a digit in the base.
+template <class N, class I>
+    // I models InputIterator
+    // N models Integer
+scan_result<I, N> scan_unsigned(I first, I last, int base = 10)
+{
+    const N max = std::numeric_limits<N>::max();
+    I begin = first;
+    N value = N(0);
+    bool overflow = false;
+
+    while (first != last) {
+        int d = digit_value(*first);
+        if (d >= base) break;
+        if (value > (max - d) / base) overflow = true;
+        else value = value * base + d;
+        ++first;
+    }
+
+    if (first == begin) return scan_result<I, N>{ first, N(0), SCAN_NO_DIGITS };
+    if (overflow)       return scan_result<I, N>{ first, N(0), SCAN_OVERFLOW };
+    return scan_result<I, N>{ first, value, SCAN_OK };
+}
+
+// Decimal digits into a non-negative N, eight digits per step while
+// eight bytes are left (see swar.h). Same results as scan_unsigned().
+template <class N>
+scan_result<const char*, N> scan_decimal(const char* first, const char* last)
+{
+    typedef typename std::make_unsigned<N>::type U;
+    if (sizeof(U) < sizeof(uint32_t)) return scan_unsigned<N>(first, last, 10);
+
+    const char* p = first;
+    U value = 0;
+    bool overflow = false;
+
+    while (last - p >= 8) {
+        uint64_t w = swar_load(p);
+        int k = swar_digit_count(w);
+        if (k == 0) break;
+        if (__builtin_mul_overflow(value, U(swar_pow10[k]), &value)
+                || __builtin_add_overflow(value, U(swar_parse_digits(w, k)), &value)) {
+            overflow = true;
+        }
+        p += k;
+        if (k < 8) break;
+    }
+    // the last few digits, or none when the loop found the end
+    while (p != last && (unsigned)(*p - '0') < 10) {
+        if (__builtin_mul_overflow(value, U(10), &value)
+                || __builtin_add_overflow(value, U(*p - '0'), &value)) {
+            overflow = true;
+        }
+        ++p;
+    }
+
+    if (p == first) return scan_result<const char*, N>{ p, N(0), SCAN_NO_DIGITS };
+    if (overflow || value > U(std::numeric_limits<N>::max())) {
+        return scan_result<const char*, N>{ p, N(0), SCAN_OVERFLOW };
+    }
+    return scan_result<const char*, N>{ p, N(value), SCAN_OK };
+}
+
+template <class N, class I>
+scan_result<I, N> scan_hex(I first, I last)   { return scan_unsigned<N>(first, last, 16); }
+
+template <class N, class I>
+scan_result<I, N> scan_octal(I first, I last) { return scan_unsigned<N>(first, last, 8); }
+
+template <class N, class I>
+scan_result<I, N> scan_magnitude(I first, I last, int base) {
+    return scan_unsigned<N>(first, last, base);
+}
+
+template <class N>
+scan_result<const char*, N> scan_magnitude(const char* first, const char* last, int base) {
+    return base == 10 ? scan_decimal<N>(first, last) : scan_unsigned<N>(first, last, base);
+}
+
+// An optional '+' or '-' and digits in `base`, into a signed N from
+// min() to max(). A sign without digits is SCAN_NO_DIGITS.
+template <class N, class I>
+scan_result<I, N> scan_signed(I first, I last, int base = 10)
+{
+    typedef typename std::make_unsigned<N>::type U;
+    I begin = first;
+    bool negative = false;
+    if (first != last && (*first == '-' || *first == '+')) {
+        negative = *first == '-';
+        ++first;
+    }
+
+    scan_result<I, U> m = scan_magnitude<U>(first, last, base);
+    if (m.status == SCAN_NO_DIGITS) return scan_result<I, N>{ begin, N(0), SCAN_NO_DIGITS };
+
+    U limit = U(std::numeric_limits<N>::max()) + (negative ? 1 : 0);
+    if (m.status == SCAN_OVERFLOW || m.value > limit) return scan_result<I, N>{ m.next, N(0), SCAN_OVERFLOW };
+    if (!negative || m.value == 0) return scan_result<I, N>{ m.next, N(m.value), SCAN_OK };
+    return scan_result<I, N>{ m.next, N(-N(m.value - 1) - 1), SCAN_OK };
+}
+
+// Digits zero .. zero+base-1, without overflow checks; kept for the
+// old callers, new code should use the scanners above.
 template <class I, class N>
     // I models ForwardIterator
     // N models Integer
 std::pair<I, N> parse_digit(I first, I last, N base, typename std::iterator_traits<I>::value_type zero)
 {
-    if (first == last) return make_pair(last, 0);
-
     N number = N(0);
 
-    while (first != last && isdigit(*first)) {
+    while (first != last && isdigit(*first) && N(*first - zero) < base) {
         number *= base;
-        if (*first >= zero && *first < zero + base) {
-            number += *first - zero;
-            first++;
-        }
+        number += *first - zero;
+        ++first;
     }
 
-    return make_pair(first, number);
+    return std::make_pair(first, number);
 }
 
 template <typename I>
@@ -0,0 +1,90 @@
+#ifndef VALUE_TAPE_H
+#define VALUE_TAPE_H
+
+#include <vector>
+#include <stdint.h>
+#include "marpa-cpp/marpa.hpp"
+
+// The valuation steps of one parse tree, recorded once from a
+// marpa::value and replayed any number of times without libmarpa.
+//
+//   value_tape tape;
+//   tape.record(v);
+//   for (int pass = 0; pass < 2; ++pass) {
+//       value_tape::cursor c = tape.replay();
+//       evaluate_steps(&e, c, &ctxt);      // or evaluate_rules(g, r, c, stack)
+//   }
+//
+// A cursor has the step(), result(), arg_0(), arg_n(), rule(), symbol(),
+// token() and token_value() of marpa::value, so the evaluators take either.
+// A step is 16 bytes and the steps are read in order.
+class value_tape {
+    public:
+        struct step_record {
+            int32_t type;
+            int32_t id;      // the rule, or the symbol of a token or nulling symbol
+            int32_t result;  // also arg_0 of a rule
+            int32_t extra;   // arg_n of a rule, otherwise the token value
+        };
+
+        class cursor {
+            public:
+                cursor(const step_record* first, const step_record* last) : pos(first), next(first), last(last) {}
+
+                marpa::value::step_type step() {
+                    if (next == last) return MARPA_STEP_INACTIVE;
+                    pos = next++;
+                    return pos->type;
+                }
+
+                int result() const { return pos->result; }
+                int arg_0() const { return pos->result; }
+                int arg_n() const { return pos->extra; }
+                int token_value() const { return pos->extra; }
+                marpa::grammar::rule_id rule() const { return pos->id; }
+                marpa::grammar::symbol_id symbol() const { return pos->id; }
+                marpa::grammar::symbol_id token() const { return pos->id; }
+            private:
+                const step_record* pos;
+                const step_record* next;
+                const step_record* last;
+        };
+
+        // Steps v to the end; the INACTIVE step is recorded too.
+        template <class V>
+        void record(V& v) {
+            steps.clear();
+            for (;;) {
+                marpa::value::step_type type = v.step();
+                step_record s{ type, -1, -1, 0 };
+                switch (type) {
+                    case MARPA_STEP_TOKEN:
+                        s.id     = v.token();
+                        s.result = v.result();
+                        s.extra  = v.token_value();
+                        break;
+                    case MARPA_STEP_RULE:
+                        s.id     = v.rule();
+                        s.result = v.arg_0();
+                        s.extra  = v.arg_n();
+                        break;
+                    case MARPA_STEP_NULLING_SYMBOL:
+                        s.id     = v.symbol();
+                        s.result = v.result();
+                        s.extra  = v.token_value();
+                        break;
+                }
+                steps.push_back(s);
+                if (type == MARPA_STEP_INACTIVE) return;
+            }
+        }
+
+        cursor replay() const { return cursor(steps.data(), steps.data() + steps.size()); }
+
+        size_t size() const { return steps.size(); }
+        void clear() { steps.clear(); }
+    private:
+        std::vector<step_record> steps;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <memory>
+
+// Runs f(job, worker) for every job in [0, n_jobs) on n_threads threads
+// and returns when all are done.
+//
+// Every worker starts with an equal contiguous range of jobs and takes
+// them from the front, in order. A worker whose range is empty steals the
+// back half of another worker's range, so uneven jobs still spread over
+// all threads. Jobs are never added, so a worker that finds every range
+// empty is done.
+template <class F>
+void parallel_jobs(size_t n_jobs, int n_threads, F f) {
+    struct range {
+        std::mutex m;
+        size_t     first;
+        size_t     last;
+    };
+
+    if (n_threads < 1) n_threads = 1;
+    std::vector<std::unique_ptr<range>> ranges;
+    for (int i = 0; i < n_threads; ++i) {
+        ranges.emplace_back(new range);
+        ranges[i]->first = n_jobs * i / n_threads;
+        ranges[i]->last  = n_jobs * (i + 1) / n_threads;
+    }
+
+    // Takes the next job of `own`, or steals half of another range into
+    // `own`. The victim's lock is released before `own` is locked.
+    auto next = [&](int self, size_t& job) -> bool {
+        range& own = *ranges[self];
+        {
+            std::lock_guard<std::mutex> lock(own.m);
+            if (own.first != own.last) {
+                job = own.first++;
+                return true;
+            }
+        }
+        for (int k = 1; k < n_threads; ++k) {
+            range& victim = *ranges[(self + k) % n_threads];
+            size_t first, last;
+            {
+                std::lock_guard<std::mutex> lock(victim.m);
+                size_t left = victim.last - victim.first;
+                if (left == 0) continue;
+                last  = victim.last;
+                first = last - (left + 1) / 2;
+                victim.last = first;
+            }
+            std::lock_guard<std::mutex> lock(own.m);
+            own.first = first + 1;
+            own.last  = last;
+            job = first;
+            return true;
+        }
+        return false;
+    };
+
+    auto worker = [&](int self) {
+        size_t job;
+        while (next(self, job)) {
+            f(job, self);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < n_threads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+#endif